@@ -0,0 +1,203 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <vector>
+#include <map>
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+#include "maze_algorithms.hpp"
+#include "maze_memory.hpp"
+
+struct BenchConfig {
+	std::vector<std::string> algos;
+	std::vector<int> sizes{64, 256, 1024};
+	int seeds = 3, threads = 1;
+	std::string format = "csv";
+};
+
+struct Result {
+	std::string algo;
+	int size;
+	uint_fast64_t seed;
+	double generate, render;
+	std::size_t bytes;
+	uint64_t allocations;
+	long peak;
+};
+
+std::vector<std::string> split(const std::string &str) {
+	std::vector<std::string> result;
+	std::istringstream fields(str);
+	std::string field;
+	while(std::getline(fields, field, ','))
+		if(field.size())
+			result.push_back(field);
+	return result;
+}
+
+void printUsage() {
+	std::cout
+			<< "Usage: bench [options]\n\n"
+
+			<< "Options:\n"
+			<< "    -h                  Display this message\n"
+			<< "    -a [algorithm,...]  Algorithms to measure; defaults to all of them\n"
+			<< "    -z [size,...]       Side lengths of the square mazes to generate; defaults to 64,256,1024\n"
+			<< "    -n [seeds]          Seeds per algorithm and size; defaults to 3\n"
+			<< "    -j [threads]        Number of threads for generation and rendering; 0 uses every core, defaults to 1\n"
+			<< "    -t [csv|json]       Report format; defaults to csv\n\n"
+
+			<< "Each run generates one maze into a fresh workspace and renders it to memory as text, timing the two separately.\n"
+			<< "Peak RSS is reset before every run where the system allows it, and is the process peak otherwise.\n"
+			<< std::endl;
+}
+
+// forgets the peak resident set size so far, where the kernel supports it
+void resetPeak() {
+#ifdef __linux__
+	std::ofstream refs("/proc/self/clear_refs");
+	refs << "5";
+#endif
+}
+
+// peak resident set size in kB, or -1 if unknown
+long peakRSS() {
+#ifdef __linux__
+	std::ifstream status("/proc/self/status");
+	std::string line;
+	while(std::getline(status, line))
+		if(line.compare(0, 6, "VmHWM:") == 0)
+			return std::stol(line.substr(6));
+#endif
+#ifndef _WIN32
+	struct rusage usage;
+	if(getrusage(RUSAGE_SELF, &usage) == 0)
+		return usage.ru_maxrss;
+#endif
+	return -1;
+}
+
+Result measure(const std::string &algo, int size, uint_fast64_t seed) {
+	Result result{algo, size, seed};
+	std::string text;
+	resetPeak();
+	const uint64_t allocations = maze::allocationCount();
+
+	maze::randinit(seed);
+	auto start = std::chrono::steady_clock::now();
+	{
+		maze::workspace ws;
+		maze::algo[algo](ws, size, size);
+		auto mid = std::chrono::steady_clock::now();
+		ws.result.render(text, "#", ".");
+		auto end = std::chrono::steady_clock::now();
+		result.generate = std::chrono::duration<double>(mid - start).count();
+		result.render = std::chrono::duration<double>(end - mid).count();
+	}
+	result.bytes = text.size();
+	result.allocations = maze::allocationCount() - allocations;
+	result.peak = peakRSS();
+	return result;
+}
+
+void report(std::ostream &out, const std::vector<Result> &results, const std::string &format) {
+	const bool json = format == "json";
+	if(json)
+		out << "[\n";
+	else
+		out << "algorithm,size,seed,cells,generate_s,cells_per_s,ns_per_cell,render_s,render_mb_per_s,allocations,peak_rss_kb\n";
+
+	for(std::size_t i = 0; i < results.size(); i++) {
+		const Result &r = results[i];
+		const double cells = double(r.size)*r.size;
+		const double rate = r.generate > 0 ? cells/r.generate : 0, ns = 1e9*r.generate/cells;
+		const double mbps = r.render > 0 ? r.bytes/r.render/1e6 : 0;
+		if(json)
+			out
+				<< "  {\"algorithm\": \"" << r.algo << "\", \"size\": " << r.size << ", \"seed\": " << r.seed
+				<< ", \"cells\": " << uint64_t(cells) << ", \"generate_s\": " << r.generate
+				<< ", \"cells_per_s\": " << rate << ", \"ns_per_cell\": " << ns
+				<< ", \"render_s\": " << r.render << ", \"render_mb_per_s\": " << mbps
+				<< ", \"allocations\": " << r.allocations << ", \"peak_rss_kb\": " << r.peak
+				<< "}" << (i + 1 < results.size() ? "," : "") << "\n";
+		else
+			out
+				<< r.algo << "," << r.size << "," << r.seed << "," << uint64_t(cells) << "," << r.generate << ","
+				<< rate << "," << ns << "," << r.render << "," << mbps << ","
+				<< r.allocations << "," << r.peak << "\n";
+	}
+	if(json)
+		out << "]\n";
+}
+
+int main(int argc, const char **argv) {
+	BenchConfig cfg;
+
+	try {
+		for(int i = 1; i < argc; i++) {
+			const std::string arg = argv[i];
+			if(arg == "-h") {
+				printUsage();
+				return 0;
+			}
+			if(arg.size() != 2 || arg[0] != '-' || i + 1 >= argc)
+				throw "unknown argument " + arg;
+			const std::string value = argv[++i];
+			switch(arg[1]) {
+				case 'a':
+					cfg.algos = split(value);
+				break;
+				case 'z':
+					cfg.sizes.clear();
+					for(const std::string &j: split(value))
+						cfg.sizes.push_back(std::stoi(j));
+				break;
+				case 'n':
+					cfg.seeds = std::stoi(value);
+				break;
+				case 'j':
+					cfg.threads = std::stoi(value);
+				break;
+				case 't':
+					cfg.format = value;
+				break;
+				default:
+					throw "unknown argument " + arg;
+			}
+		}
+		if(cfg.format != "csv" && cfg.format != "json")
+			throw "unknown report format " + cfg.format;
+		for(const std::string &algo: cfg.algos)
+			if(!maze::algo.count(algo))
+				throw "unknown algorithm " + algo;
+		for(int size: cfg.sizes)
+			if(size < 1 || size > UINT16_MAX)
+				throw "maze size is out of its allowed range; try 1 to " + std::to_string(UINT16_MAX);
+	} catch(const std::string &msg) {
+		std::cerr << "Error: " << msg << "\n" << std::endl;
+		printUsage();
+		return 1;
+	} catch(const std::logic_error &) {
+		std::cerr << "Error: malformed number\n" << std::endl;
+		printUsage();
+		return 1;
+	}
+	if(cfg.algos.empty())
+		for(const auto &i: maze::algo)
+			cfg.algos.push_back(i.first);
+
+	maze::setConcurrency(cfg.threads);
+	std::vector<Result> results;
+	for(const std::string &algo: cfg.algos)
+		for(int size: cfg.sizes)
+			for(int seed = 0; seed < cfg.seeds; seed++) {
+				results.push_back(measure(algo, size, seed));
+				std::cerr << algo << " " << size << "x" << size << " seed " << seed << ": " << results.back().generate << " s\n";
+			}
+	report(std::cout, results, cfg.format);
+
+	return 0;
+}
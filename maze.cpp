@@ -1,14 +1,34 @@
 #include <iostream>
 #include <fstream>
 #include <map>
+#include <csignal>
+#ifdef _WIN32
+#include <io.h>
+#define isatty _isatty
+#else
+#include <unistd.h>
+#endif
 
 #include "maze_algorithms.hpp"
+#include "maze_analysis.hpp"
+#include "maze_batch.hpp"
+#include "maze_binary.hpp"
+#include "maze_infinite.hpp"
+#include "maze_memory.hpp"
+#include "maze_solve.hpp"
+#include "maze_stats.hpp"
+#include "maze_tiled.hpp"
 
 struct Config {
-	uint16_t width = 0, height = 0;
-	std::string wallStr = "#", blankStr = ".", algo = "recursive-backtracker";
-	uint_fast64_t seed;
-	bool seed_set = false;
+	uint64_t width = 0;
+	uint_fast64_t height = 0;
+	std::string wallStr = "#", blankStr = ".", pathStr = "", algo = "recursive-backtracker", solver = "";
+	uint_fast64_t seed, count = 0;
+	std::string manifest = "", format = "text", input = "";
+	maze::image_style image = {false, 1, 1};
+	int threads = 1, tile = 0;
+	int64_t origin[2] = {0, 0};
+	bool seed_set = false, infinite = false, report = false, stats = false, analyze = false, window = false;
 };
 
 template<class T> T parse_int(const std::string &str, const std::string &var_name, bool allow_zero = false) {
@@ -50,10 +70,33 @@ void printUsage() {
 			<< "                        Algorithm for maze generation; defaults to recursive-backtracker\n"
 			<< "    -s [seed]           Random seed for maze generation; ranges from 0 to " << UINT_FAST64_MAX << ", defaults to current time in microseconds\n"
 			<< "    -o [filename]       Filename for maze output; defaults to stdout\n"
+			<< "    -t [text|binary|pbm|pgm]\n"
+			<< "                        Output format; binary is a header and the bit-packed wall planes, pbm and pgm are images, defaults to text\n"
+			<< "    -z [cell],[wall]    Pixel size of cells and thickness of walls in pbm/pgm output; defaults to 1,1\n"
+			<< "    -i [filename]       Read a binary maze instead of generating one; width and height come from the file\n"
+			<< "    -j [threads]        Number of threads for generation and rendering; 0 uses every core, defaults to 1\n"
 			<< "    -w[string]          Text representation for walls; defaults to #\n"
 			<< "    -b[string]          Text representation for blank spaces; defaults to .\n"
 			<< "    -W                  Widen text representation of generated maze horizontally; equivalent to -w## -b..\n"
-			<< "    -f                  Force; don't warn about slow algorithms\n\n"
+			<< "    -S [" << join_map(maze::solver, "|") << "]\n"
+			<< "                        Solve the maze from the top left to the bottom right cell and draw the path in the text output\n"
+			<< "    -p[string]          Text representation for the path; defaults to o, repeated as wide as blank spaces\n"
+			<< "    -A                  Analyze the maze and write a JSON report of its dead ends, corridors, river factor, branching and distances instead of the maze\n"
+			<< "    -f                  Force; don't warn about slow algorithms\n"
+			<< "    -r                  Report generation throughput and heap allocations to stderr\n"
+			<< "    -v, --stats         Dump phase times and hot-path counters as JSON to stderr; counters need a build with make STATS=1\n"
+			<< "    -n [count]          Batch mode: generate count mazes with seeds counting up from -s\n"
+			<< "    -m [manifest]       Batch mode: generate one maze per manifest line 'algorithm width height seed'\n"
+			<< "    -T [tile]           Tiled mode: generate the maze tile by tile, tile x tile cells each, writing every tile straight into the -o file\n"
+			<< "    -I [x],[y]          Window mode: output the width x height cells from (x, y) of an endless maze; x and y may be negative\n\n"
+
+			<< "In batch mode, mazes are generated in parallel on -j threads and written one after another; an -o filename containing %d writes maze i to its own file instead. Throughput and heap allocations are reported to stderr.\n\n"
+
+			<< "With -a eller, rows are streamed to the output as they are generated; height may exceed 65535, or be 'inf' to stream text until the output is closed.\n\n"
+
+			<< "In tiled mode, width and height go up to 4294967295 as long as the output fits in a file on the system: text takes about 4 x width x height bytes per character of wall, binary about width x height / 4. Tiles go up to 65535 cells a side. Memory depends on the tile size and -j, plus a few bytes per tile across a row. Each tile is a maze of its own, seeded by its position. Neighboring tiles are joined through one opening where an Eller maze over the tiles, streamed a row of tiles at a time, dictates, so the whole maze stays perfect. Output is text, with walls and blank spaces of the same width, or binary, with tiles a multiple of 64 cells wide; -i only reads binary mazes up to 65535 cells a side back in.\n\n"
+
+			<< "In window mode, the endless maze is made of 64 x 64 cell chunks, each generated from the seed and its position only when a window touches it, so the same seed always shows the same maze at the same place; x + width and y + height go up to 9223372036854775807. Every chunk opens to its left or upper neighbor, so the whole maze is perfect; passages leading out of the window are left open on its edges. -S and -A only look inside the window: they treat its edges as walls, so its corners may not be connected within it.\n\n"
 			
 			<< "For more information about maze generation algorithms, visit http://weblog.jamisbuck.org/2011/2/7/maze-generation-algorithm-recap\n"
 			<< std::endl;
@@ -68,6 +111,11 @@ void panic(const std::string &msg, bool usage = false) {
 
 void warn(const std::string &msg) {
 	std::string response;
+	// there's nobody to ask in a batch job, so just note it and carry on
+	if(!isatty(0)) {
+		std::cerr << "Warning: " << msg << std::endl;
+		return;
+	}
 	std::cout << msg << "\n";
 	while(true) {
 		std::cout << "Continue? (Y/N) ";
@@ -90,31 +138,98 @@ void readArgs(const int argc, const char **argv, Config &cfg, std::string &fname
 				case 'a':
 					cfg.algo = argv[i];
 				break;
+				case 'i':
+					cfg.input = argv[i];
+				break;
+				case 'I': {
+					const std::string at = argv[i];
+					const std::size_t comma = at.find(',');
+					if(comma == std::string::npos)
+						throw std::string("window position should be x,y");
+					try {
+						cfg.origin[0] = std::stoll(at.substr(0, comma));
+						cfg.origin[1] = std::stoll(at.substr(comma + 1));
+					} catch(const std::invalid_argument &err) {
+						throw std::string("malformed argument window position");
+					} catch(const std::out_of_range &err) {
+						throw "window position is out of its allowed range; try " + std::to_string(INT64_MIN) + " to " + std::to_string(INT64_MAX);
+					}
+					cfg.window = true;
+				}
+				break;
+				case 'j':
+					cfg.threads = parse_int<uint16_t>(argv[i], "thread count", true);
+				break;
+				case 'm':
+					cfg.manifest = argv[i];
+				break;
+				case 'n':
+					cfg.count = parse_int<uint32_t>(argv[i], "maze count");
+				break;
 				case 'o':
 					fname = argv[i];
 				break;
+				case 'S':
+					cfg.solver = argv[i];
+				break;
+				case 'T':
+					cfg.tile = parse_int<uint16_t>(argv[i], "tile size");
+				break;
 				case 's':
 					cfg.seed = parse_int<uint_fast64_t>(argv[i], "seed", true);
 					cfg.seed_set = true;
 				break;
+				case 't':
+					cfg.format = argv[i];
+				break;
+				case 'z': {
+					const std::string sizes = argv[i];
+					const std::size_t comma = sizes.find(',');
+					cfg.image.cell = parse_int<uint8_t>(sizes.substr(0, comma), "cell size");
+					cfg.image.wall = comma == std::string::npos ? cfg.image.cell : parse_int<uint8_t>(sizes.substr(comma + 1), "wall size");
+				}
+				break;
 			}
 			argChain = '\0';
+		} else if(std::string(argv[i]) == "--stats") {
+			cfg.stats = true;
 		} else if(argv[i][0] == '-') {
 			switch(argv[i][1]) {
 				case 'a':
+				case 'i':
+				case 'I':
+				case 'j':
+				case 'm':
+				case 'n':
 				case 'o':
 				case 's':
+				case 'S':
+				case 'T':
+				case 't':
+				case 'z':
 					argChain = argv[i][1];
 				break;
 				case 'b':
 					cfg.blankStr = argv[i] + 2;
 				break;
+				case 'p':
+					cfg.pathStr = argv[i] + 2;
+				break;
+				case 'A':
+					cfg.analyze = true;
+				break;
 				case 'f':
 					force = true;
 				break;
 				case 'h':
 					helpMode = true;
 				break;
+				case 'r':
+					cfg.report = true;
+				break;
+				case 'v':
+					cfg.stats = true;
+				break;
 				case 'w':
 					cfg.wallStr = argv[i] + 2;
 				break;
@@ -126,9 +241,13 @@ void readArgs(const int argc, const char **argv, Config &cfg, std::string &fname
 					throw std::string("unknown argument ") + argv[i];
 			}
 		} else if(!cfg.width)
-			cfg.width = parse_int<uint16_t>(argv[i], "width");
-		else if(!cfg.height)
-			cfg.height = parse_int<uint16_t>(argv[i], "height");
+			cfg.width = parse_int<uint32_t>(argv[i], "width");
+		else if(!cfg.height && !cfg.infinite) {
+			if(std::string(argv[i]) == "inf")
+				cfg.infinite = true;
+			else
+				cfg.height = parse_int<uint_fast64_t>(argv[i], "height");
+		}
 	}
 }
 
@@ -145,38 +264,171 @@ int main(int argc, const char** argv) {
 	}
 	if(!err.size() && !maze::algo.count(cfg.algo))
 		err = "unknown algorithm " + cfg.algo;
+	if(!err.size() && cfg.format != "text" && cfg.format != "binary" && cfg.format != "pbm" && cfg.format != "pgm")
+		err = "unknown output format " + cfg.format;
+	const bool image = cfg.format == "pbm" || cfg.format == "pgm";
+	cfg.image.gray = cfg.format == "pgm";
+	if(!err.size() && cfg.solver.size() && !maze::solver.count(cfg.solver))
+		err = "unknown solver " + cfg.solver;
+	if(!err.size() && cfg.solver.size() && cfg.format != "text")
+		err = "only text output can show a solution";
+	const bool batch = cfg.count || cfg.manifest.size();
+	if(!err.size() && batch && cfg.input.size())
+		err = "batch mode can't read a maze with -i";
+	if(!err.size() && batch && cfg.solver.size())
+		err = "batch mode can't solve mazes";
+	if(!err.size() && cfg.analyze && (batch || cfg.solver.size() || cfg.format != "text"))
+		err = "-A writes a report instead of a maze, so it can't be used with -S, -t or batch mode";
+	const bool tiled = cfg.tile;
+	if(!err.size() && tiled && (batch || cfg.input.size() || cfg.solver.size() || cfg.analyze || image || cfg.infinite))
+		err = "tiled mode writes a new maze as text or binary, so it can't be used with -i, -S, -A, images, infinite height or batch mode";
+	if(!err.size() && tiled && !fname.size())
+		err = "tiled mode writes its tiles into a file, so it needs -o";
+	if(!err.size() && cfg.window && (batch || cfg.input.size() || tiled || cfg.infinite))
+		err = "window mode shows part of an endless maze, so it can't be used with -i, -T, infinite height or batch mode";
+	const bool streaming = cfg.algo == "eller" && cfg.format != "binary" && !batch && !cfg.input.size() && !cfg.solver.size() && !cfg.analyze && !tiled && !cfg.window;
+	if(!err.size() && (!streaming || image) && cfg.infinite)
+		err = "only eller with plain text output supports infinite height";
+	if(!cfg.pathStr.size())
+		cfg.pathStr = std::string(std::max<std::size_t>(1, cfg.blankStr.size()), 'o');
+	if(!err.size() && !tiled && cfg.width > UINT16_MAX)
+		err = "width is out of its allowed range; try " + std::to_string(UINT16_MAX) + " or less, or generate in tiles with -T";
+	if(!err.size() && !streaming && !tiled && cfg.height > UINT16_MAX)
+		err = "height is out of its allowed range; try " + std::to_string(UINT16_MAX) + " or less";
+	if(!err.size() && tiled && cfg.height > UINT32_MAX)
+		err = "height is out of its allowed range; try " + std::to_string(UINT32_MAX) + " or less";
 	if(err.size())
 		panic(err, true);
 	
-	if(argc == 1 || helpMode || !cfg.width || !cfg.height) {
+	if(argc == 1 || helpMode || (!cfg.manifest.size() && !cfg.input.size() && (!cfg.width || !(cfg.height || cfg.infinite)))) {
 		printUsage();
 		return 0;
 	}
 
+	maze::setConcurrency(cfg.threads);
 	if(cfg.seed_set)
 		maze::randinit(cfg.seed);
 	else
 		maze::randinit();
 	
+	if(batch) {
+		try {
+			std::vector<maze::job> jobs;
+			if(cfg.manifest.size()) {
+				std::ifstream manifest(cfg.manifest);
+				if(!manifest.is_open())
+					throw "couldn't open " + cfg.manifest;
+				jobs = maze::readManifest(manifest);
+			} else
+				for(uint_fast64_t i = 0; i < cfg.count; i++)
+					jobs.push_back({cfg.algo, int(cfg.width), int(cfg.height), maze::random_engine.getKey() + i});
+
+			std::ofstream outfile;
+			const bool numbered = fname.find("%d") != std::string::npos;
+			if(fname.size() && !numbered) {
+				outfile.open(fname);
+				if(!outfile.is_open())
+					throw "couldn't open " + fname;
+			}
+
+			const auto start = std::chrono::steady_clock::now();
+			const uint64_t allocations = maze::allocationCount();
+			maze::runBatch(jobs, fname.size() && !numbered ? maze::sink(outfile) : maze::sink(1), numbered ? fname : "", cfg.format, cfg.wallStr, cfg.blankStr, cfg.image);
+			const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			if(cfg.stats)
+				std::cerr << maze::stats::report() << std::endl;
+			std::cerr << jobs.size() << " mazes in " << elapsed << " s (" << (elapsed > 0 ? jobs.size()/elapsed : 0) << " mazes/sec, " << maze::allocationCount() - allocations << " heap allocations)" << std::endl;
+		} catch(const std::string &msg) {
+			panic(msg);
+		}
+		return 0;
+	}
+
 	if(!force && maze::algo_is_slow.count(cfg.algo) && 2*cfg.width*cfg.height - cfg.width - cfg.height >= 100000)
 		warn("The algorithm '" + cfg.algo + "' is considerably slower than other algorithms, especially with large mazes. You can always abort by pressing Ctrl+Z.");
 	try {
-		std::ostream *preout = &std::cout;
 		std::ofstream *outfile;
 		bool file_output = false;
-		if(fname.size()) {
+		if(fname.size() && !tiled) {
 			file_output = true;
-			outfile = new std::ofstream(fname);
+			outfile = new std::ofstream(fname, std::ios::binary);
 			if(!outfile->is_open())
 				throw "couldn't open " + fname;
-			preout = outfile;
 		}
-		std::ostream &out = *preout;
+		std::cout.flush();
+		maze::sink out = file_output ? maze::sink(*outfile) : maze::sink(1);
 
-		out << maze::algo[cfg.algo](cfg.width, cfg.height).toString(cfg.wallStr, cfg.blankStr);
+		const auto start = std::chrono::steady_clock::now();
+		const uint64_t allocations = maze::allocationCount();
+		uint_fast64_t rows = 0;
+		if(tiled) {
+			maze::generateTiled(fname, cfg.width, cfg.height, cfg.tile, cfg.algo, maze::random_engine.getKey(), cfg.format, cfg.wallStr, cfg.blankStr);
+			rows = cfg.height;
+		} else if(streaming) {
+#ifdef SIGPIPE
+			std::signal(SIGPIPE, SIG_IGN);
+#endif
+			try {
+				if(image)
+					maze::streamEller(out, int(cfg.width), cfg.height, cfg.image, rows);
+				else
+					maze::streamEller(out, int(cfg.width), cfg.height, cfg.wallStr, cfg.blankStr, rows);
+			} catch(const std::string &) {
+				// an endless stream only stops when its reader goes away
+				if(!cfg.infinite)
+					throw;
+			}
+		} else {
+			maze::workspace ws;
+			std::unique_ptr<maze::mapped_structure> input;
+			std::string algo = cfg.algo;
+			uint64_t seed = maze::random_engine.getKey();
+			if(cfg.input.size()) {
+				input.reset(new maze::mapped_structure(cfg.input));
+				algo = input->algorithm();
+				seed = input->getSeed();
+			} else if(cfg.window) {
+				// the window's edges may be open, which the solvers and the
+				// analysis read as walls
+				MAZE_PHASE(generate);
+				maze::infinite_maze(cfg.algo, seed).region(ws.result, cfg.origin[0], cfg.origin[1], int(cfg.width), int(cfg.height));
+			} else {
+				MAZE_PHASE(generate);
+				maze::algo[cfg.algo](ws, int(cfg.width), int(cfg.height));
+			}
+
+			const maze::structure &maze = input ? input->get() : ws.result;
+			if(cfg.analyze) {
+				MAZE_PHASE(analyze);
+				const std::string report = maze::analyze(maze).toJSON() + "\n";
+				out.write(report.data(), report.size());
+			} else if(cfg.solver.size()) {
+				maze::bitplane route(0, 0, false);
+				{
+					MAZE_PHASE(solve);
+					route = maze::solver[cfg.solver](maze, 0, 0, maze.getWidth() - 1, maze.getHeight() - 1);
+				}
+				MAZE_PHASE(render);
+				maze.render(out, cfg.wallStr, cfg.blankStr, route, cfg.pathStr);
+			} else {
+				MAZE_PHASE(render);
+				if(cfg.format == "binary")
+					maze::writeBinary(out, maze, algo, seed);
+				else if(image)
+					maze.render(out, cfg.image);
+				else
+					maze.render(out, cfg.wallStr, cfg.blankStr);
+			}
+			rows = maze.getHeight();
+		}
+		const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
 
 		if(file_output)
 			outfile->close();
+		if(cfg.stats)
+			std::cerr << maze::stats::report() << std::endl;
+		if(cfg.report)
+			std::cerr << rows << " rows in " << elapsed << " s (" << (elapsed > 0 ? rows/elapsed : 0) << " rows/sec, " << maze::allocationCount() - allocations << " heap allocations)" << std::endl;
 	} catch(const std::string &msg) {
 		panic(msg);
 	}
@@ -1,63 +1,130 @@
-#define DEBUG_MODE false
-
 #include <stack>
 #include <queue>
 #include <tuple>
 #include <algorithm>
-#if DEBUG_MODE
-#include <iostream>
-#endif
+#include <sstream>
 
 #include "maze_algorithms.hpp"
+#include "maze_stats.hpp"
 
-using coord = std::pair<int, int>;
-using it = std::vector<bool>::iterator;
-template<class T> using matrix_t = std::vector<std::vector<T> >;
+using it = maze::bitplane::iterator;
 
 namespace maze {
-	std::mt19937_64 random_engine;
-
-	void randinit(uint_fast64_t seed) {
-		random_engine.seed(seed);
+	bitplane::reference::reference(uint64_t *word_, uint64_t mask_):
+		word(word_), mask(mask_) {}
+	bitplane::reference::operator bool() const {
+		return *word & mask;
 	}
-	int rand(int max) {
-		std::uniform_int_distribution<> dist(0, max - 1);
-		return dist(maze::random_engine);
+	bitplane::reference &bitplane::reference::operator=(bool value) {
+		*word = value ? *word | mask : *word & ~mask;
+		return *this;
+	}
+	bitplane::reference &bitplane::reference::operator=(const reference &other) {
+		return *this = bool(other);
 	}
-	int randbit(int bits) {
-		int n = 0, t = bits, r;
-		while(t) {
-			n += t % 2;
-			t /= 2;
-		}
 
-		if(!n)
-			return 0;
-		r = maze::rand(n);
-		for(int i = 0;; i++) {
-			if(bits & 1 << i)
-				if(!r--)
-					return i;
-		}
+	bitplane::iterator::iterator(uint64_t *word_, uint64_t mask_):
+		word(word_), mask(mask_) {}
+	maze::bitplane::reference bitplane::iterator::operator*() const {
+		return maze::bitplane::reference(word, mask);
+	}
+
+	// rows are stored top to bottom, each padded to a whole number of 64-bit words;
+	// padding bits past the last column are always zero
+	bitplane::bitplane(int w, int h, bool init_value) {
+		reset(w, h, init_value);
+	}
+	// a view of rows laid out the same way in memory the bitplane doesn't own
+	bitplane::bitplane(int w, int h, uint64_t *view_):
+		width(w), height(h),
+		stride((w + 63)/64),
+		view(view_) {}
+	// reuses the storage already held when it is large enough
+	void bitplane::reset(int w, int h, bool init_value) {
+		width = w;
+		height = h;
+		stride = (w + 63)/64;
+		view = nullptr;
+		data.assign(stride*h, 0);
+		if(init_value)
+			for(int i = 0; i < h; i++) {
+				uint64_t *r = row(i);
+				for(int j = 0; j < w/64; j++)
+					r[j] = ~uint64_t(0);
+				if(w % 64)
+					r[w/64] = (uint64_t(1) << w % 64) - 1;
+			}
+	}
+	void bitplane::setAtomic(int x, int y, bool value) {
+		uint64_t *word = row(y) + x/64, mask = uint64_t(1) << x % 64;
+		if(value)
+			__atomic_fetch_or(word, mask, __ATOMIC_RELAXED);
+		else
+			__atomic_fetch_and(word, ~mask, __ATOMIC_RELAXED);
+	}
+	maze::bitplane::iterator bitplane::at(int x, int y) {
+		return maze::bitplane::iterator(row(y) + x/64, uint64_t(1) << x % 64);
+	}
+	std::size_t bitplane::words() const {
+		return stride;
 	}
 
+	// hor holds the walls above each row of cells (h + 1 rows of w bits),
+	// vert the walls left of each column (h rows of w + 1 bits)
 	structure::structure(int w, int h, bool init_value):
+		hor(0, 0, false), vert(0, 0, false) {
+			reset(w, h, init_value);
+		}
+	// a view of wall planes kept elsewhere, such as a mapped maze file
+	structure::structure(int w, int h, uint64_t *hor_, uint64_t *vert_):
 		width(w), height(h),
-		hor(w), vert(w + 1) {
-			for(std::vector<bool> &i: hor)
-				i.resize(h + 1, init_value);
-			for(std::vector<bool> &i: vert)
-				i.resize(h, init_value);
-			for(int i = 0; i < w; i++)
-				hor[i][0] = hor[i][h] = true;
-			for(int i = 0; i < h; i++)
-				vert[0][i] = vert[w][i] = true;
+		hor(w, h + 1, hor_), vert(w + 1, h, vert_) {}
+	void structure::reset(int w, int h, bool init_value) {
+		width = w;
+		height = h;
+		hor.reset(w, h + 1, init_value);
+		vert.reset(w + 1, h, init_value);
+		for(int i = 0; i < w; i++) {
+			hor.set(i, 0, true);
+			hor.set(i, h, true);
 		}
-	template<class T> maze::matrix<T> structure::matrix(T val, T out) const {
-		return maze::matrix<T>(width, height, val, out);
+		for(int i = 0; i < h; i++) {
+			vert.set(0, i, true);
+			vert.set(w, i, true);
+		}
+	}
+	int structure::getWidth() const {
+		return width;
+	}
+	int structure::getHeight() const {
+		return height;
+	}
+	maze::bitplane &structure::horizontal() {
+		return hor;
 	}
-	maze::disjoint_set structure::disjoint_set() const {
-		return maze::disjoint_set(width, height);
+	maze::bitplane &structure::vertical() {
+		return vert;
+	}
+	const maze::bitplane &structure::horizontal() const {
+		return hor;
+	}
+	const maze::bitplane &structure::vertical() const {
+		return vert;
+	}
+	uint64_t structure::openings(int y, std::size_t j, uint64_t ways[4]) const {
+		const std::size_t words = hor.words(), sides = vert.words();
+		const uint64_t *left = vert.row(y), *up = hor.row(y), *down = hor.row(y + 1);
+		const uint64_t
+			cells = j + 1 < words || width % 64 == 0 ? ~uint64_t(0) : (uint64_t(1) << width % 64) - 1,
+			last = j + 1 < words ? ~uint64_t(0) : ~(uint64_t(1) << (width - 1) % 64);
+		ways[0] = ~left[j] & (j ? ~uint64_t(0) : ~uint64_t(1)) & cells;
+		ways[1] = ~(left[j] >> 1 | (j + 1 < sides ? left[j + 1] << 63 : 0)) & cells & last;
+		ways[2] = y > 0 ? ~up[j] & cells : 0;
+		ways[3] = y < height - 1 ? ~down[j] & cells : 0;
+		return cells;
+	}
+	maze::disjoint_set structure::disjoint_set(bool packed) const {
+		return maze::disjoint_set(uint32_t(width)*height, packed);
 	}
 	maze::cell structure::operator()(int x, int y) {
 		return maze::cell(this, x, y);
@@ -65,132 +132,288 @@ namespace maze {
 	maze::cell structure::operator()(std::pair<int, int> pos) {
 		return maze::cell(this, pos.first, pos.second);
 	}
-	std::string structure::toString(std::string &wall, std::string &blank) {
-		std::string result = "";
-		for(int i = 0; i < 2*height + 1; i++) {
-			for(int j = 0; j < 2*width + 1; j++) {
-				bool tile = false;
-				switch(j%2 << 1 | i%2) {
-					case 0:
-						tile = true;
-					break;
-					case 1:
-						tile = vert[j/2][i/2];
-					break;
-					case 2:
-						tile = hor[j/2][i/2];
-					break;
+	// with more than one thread, bands of rows are rendered side by side into
+	// per-band buffers that are then written out in order; make(sink) creates
+	// a renderer and rowSize is about how much it writes per maze row
+	template<class make_t> void renderRows(const maze::bitplane &hor, const maze::bitplane &vert, int height, maze::sink out, std::size_t rowSize, const make_t &make) {
+		const int threads = maze::getConcurrency();
+		if(threads == 1) {
+			auto renderer = make(out);
+			for(int i = 0; i < height; i++) {
+				renderer.horizontal(hor.row(i));
+				renderer.vertical(vert.row(i));
+			}
+			renderer.horizontal(hor.row(height));
+			renderer.flush();
+			return;
+		}
+
+		const int band = std::max<std::size_t>(1, maze::text_renderer::chunk_size/rowSize);
+		std::vector<std::string> buffers(threads);
+		for(int i = 0; i < height; i += band*threads) {
+			maze::pool().run(threads, [&](int t) {
+				const int from = std::min(height, i + t*band), to = std::min(height, from + band);
+				buffers[t].clear();
+				auto renderer = make(buffers[t]);
+				for(int j = from; j < to; j++) {
+					renderer.horizontal(hor.row(j));
+					renderer.vertical(vert.row(j));
 				}
-				result += tile ? wall : blank;
+				renderer.flush();
+			});
+			for(const std::string &j: buffers)
+				out.write(j.data(), j.size());
+		}
+		auto renderer = make(out);
+		renderer.horizontal(hor.row(height));
+		renderer.flush();
+	}
+	void structure::render(maze::sink out, const std::string &wall, const std::string &blank) const {
+		const std::size_t rowSize = 2*(2*std::size_t(width) + 1)*std::max(wall.size(), blank.size()) + 2;
+		maze::renderRows(hor, vert, height, out, rowSize, [&](maze::sink to) {
+			return maze::text_renderer(to, width, wall, blank);
+		});
+	}
+	void structure::render(maze::sink out, const maze::image_style &style) const {
+		maze::image_renderer head(out, width, style);
+		head.header(height);
+		maze::renderRows(hor, vert, height, out, head.rowSize(), [&](maze::sink to) {
+			return maze::image_renderer(to, width, style);
+		});
+	}
+	// draws the cells of route, and the open walls between them, with path
+	void structure::render(maze::sink out, const std::string &wall, const std::string &blank, const maze::bitplane &route, const std::string &path) const {
+		maze::text_renderer renderer(out, width, wall, blank, path);
+		const std::size_t words = hor.words(), sides = vert.words();
+		std::vector<uint64_t> passages(sides);
+		for(int i = 0; i <= height; i++) {
+			for(std::size_t j = 0; j < words; j++)
+				passages[j] = i > 0 && i < height ? route.row(i - 1)[j] & route.row(i)[j] & ~hor.row(i)[j] : 0;
+			renderer.horizontal(hor.row(i), passages.data());
+			if(i == height)
+				break;
+
+			uint64_t carry = 0;
+			for(std::size_t j = 0; j < sides; j++) {
+				const uint64_t cells = j < words ? route.row(i)[j] : 0;
+				passages[j] = (cells << 1 | carry) & cells & ~vert.row(i)[j];
+				carry = cells >> 63;
 			}
-			result += "\n";
+			renderer.vertical(vert.row(i), passages.data(), route.row(i));
 		}
-		return result;
+		renderer.flush();
+	}
+	std::string structure::toString(std::string &wall, std::string &blank) {
+		std::ostringstream result;
+		render(result, wall, blank);
+		return result.str();
+	}
+	std::string structure::toString(const std::string &wall, const std::string &blank, const maze::bitplane &route, const std::string &path) const {
+		std::ostringstream result;
+		render(result, wall, blank, route, path);
+		return result.str();
 	}
 
 	cell::cell(maze::structure *from_, int x_, int y_):
 		from(from_), x(x_), y(y_) {}
 	it cell::left() const {
-		return from->vert[x].begin() + y;
+		return from->vert.at(x, y);
 	}
 	it cell::right() const {
-		return from->vert[x + 1].begin() + y;
+		return from->vert.at(x + 1, y);
 	}
 	it cell::up() const {
-		return from->hor[x].begin() + y;
+		return from->hor.at(x, y);
 	}
 	it cell::down() const {
-		return from->hor[x].begin() + (y + 1);
+		return from->hor.at(x, y + 1);
 	}
 
-	template<class T> matrix<T>::matrix(int w, int h, T val, T out):
-		width(w), height(h),
-		def(out),
-		data(width) {
-			for(std::vector<T> &i: data) {
-				i.resize(height, val);
-			}
-		}
-	template<class T> maze::matrix_cell<T> matrix<T>::operator()(int x, int y) {
-		return maze::matrix_cell<T>(this, x, y);
+	disjoint_set::disjoint_set(uint32_t n, bool packed_) {
+		reset(n, packed_);
 	}
-	template<class T> maze::matrix_cell<T> matrix<T>::operator()(std::pair<int, int> pos) {
-		return maze::matrix_cell<T>(this, pos.first, pos.second);
+	void disjoint_set::reset() {
+		for(uint32_t i = 0; i < set.size(); i++)
+			set[i] = packed ? UINT32_MAX : i;
+		std::fill(rank.begin(), rank.end(), 0);
 	}
-
-	disjoint_set::disjoint_set(int w, int h):
-		width(w), height(h),
-		set(width) {
-			for(int i = 0; i < width; i++) {
-				set[i].resize(height, std::make_pair(i, 0));
-				for(int j = 0; j < height; j++)
-					set[i][j].second = j;
-			}
-		}
-	bool disjoint_set::join(coord a, coord b) {
-		const coord aroot = find(a), broot = find(b);
+	void disjoint_set::reset(uint32_t n, bool packed_) {
+		packed = packed_;
+		set.resize(n);
+		rank.resize(packed ? 0 : n);
+		reset();
+	}
+	bool disjoint_set::join(uint32_t a, uint32_t b) {
+		MAZE_COUNT(joins, 1);
+		uint32_t aroot = find(a), broot = find(b);
 		if(aroot == broot)
 			return false;
-		set[broot.first][broot.second] = aroot;
+		if(packed) {
+			// a smaller slot value is a larger rank
+			if(set[aroot] > set[broot])
+				std::swap(aroot, broot);
+			if(set[aroot] == set[broot])
+				set[aroot]--;
+		} else {
+			if(rank[aroot] < rank[broot])
+				std::swap(aroot, broot);
+			if(rank[aroot] == rank[broot])
+				rank[aroot]++;
+		}
+		set[broot] = aroot;
 		return true;
 	}
-	coord disjoint_set::find(coord a) {
-		coord &y = set[a.first][a.second];
-		return y == a ? a : (y = find(y));
+	uint32_t disjoint_set::find(uint32_t a) {
+		MAZE_COUNT(finds, 1);
+		if(packed) {
+			while(set[a] < UINT32_MAX - 64) {
+				MAZE_COUNT(find_steps, 1);
+				const uint32_t parent = set[a];
+				if(set[parent] < UINT32_MAX - 64)
+					set[a] = set[parent];
+				a = set[a];
+			}
+			return a;
+		}
+		while(set[a] != a) {
+			MAZE_COUNT(find_steps, 1);
+			set[a] = set[set[a]];
+			a = set[a];
+		}
+		return a;
 	}
 
-	template<class T> matrix_cell<T>::matrix_cell(maze::matrix<T> *from_, int x_, int y_):
-		from(from_),
-		x(x_), y(y_) {}
-	template<class T> maze::matrix_cell<T> matrix_cell<T>::left() const {
-		return matrix_cell(from, x - 1, y);
-	}
-	template<class T> maze::matrix_cell<T> matrix_cell<T>::right() const {
-		return matrix_cell(from, x + 1, y);
+	concurrent_disjoint_set::concurrent_disjoint_set(uint32_t n) {
+		reset(n);
 	}
-	template<class T> maze::matrix_cell<T> matrix_cell<T>::up() const {
-		return matrix_cell(from, x, y - 1);
+	// not thread-safe itself; slots are only touched through atomic builtins after this
+	void concurrent_disjoint_set::reset(uint32_t n) {
+		set.resize(n);
+		maze::parallel_for(0, n, [&](int from, int to) {
+			for(int i = from; i < to; i++)
+				set[i] = i;
+		});
 	}
-	template<class T> maze::matrix_cell<T> matrix_cell<T>::down() const {
-		return matrix_cell(from, x, y + 1);
+	// links the root with the larger index under the other; a failed CAS means
+	// another thread moved that root first, so look both up again
+	bool concurrent_disjoint_set::join(uint32_t a, uint32_t b) {
+		MAZE_COUNT(joins, 1);
+		while(true) {
+			uint32_t aroot = find(a), broot = find(b);
+			if(aroot == broot)
+				return false;
+			if(aroot > broot)
+				std::swap(aroot, broot);
+			uint32_t expected = broot;
+			if(__atomic_compare_exchange_n(&set[broot], &expected, aroot, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+				return true;
+		}
 	}
-	template<class T> T matrix_cell<T>::operator()() const {
-		return x >= 0 && x < from->width && y >= 0 && y < from->height ? from->data[x][y] : from->def;
+	// iterative path halving; a lost CAS only skips one shortcut
+	uint32_t concurrent_disjoint_set::find(uint32_t a) {
+		MAZE_COUNT(finds, 1);
+		while(true) {
+			uint32_t parent = __atomic_load_n(&set[a], __ATOMIC_RELAXED);
+			if(parent == a)
+				return a;
+			MAZE_COUNT(find_steps, 1);
+			const uint32_t grandparent = __atomic_load_n(&set[parent], __ATOMIC_RELAXED);
+			if(parent != grandparent)
+				__atomic_compare_exchange_n(&set[a], &parent, grandparent, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+			a = grandparent;
+		}
 	}
-	template<class T> T matrix_cell<T>::operator()(T n) const {
-		return x >= 0 && x < from->width && y >= 0 && y < from->height ? (from->data[x][y] = n) : n;
+
+	eller_stream::eller_stream(int w):
+		now(0), next(0) {
+			reset(w);
+		}
+	void eller_stream::reset(int w) {
+		width = w;
+		words = (w + 63)/64;
+		now.reset(w);
+		next.reset(w);
+		head.assign(w, -1);
+		link.assign(w, 0);
+		vert.assign((w + 64)/64, 0);
+		hor.assign(words, 0);
 	}
+	void eller_stream::advance(bool last) {
+		std::swap(now, next);
+		next.reset();
+		std::fill(vert.begin(), vert.end(), 0);
+		vert[0] |= 1;
+		vert[width/64] |= uint64_t(1) << width % 64;
+		for(std::size_t i = 0; i < words; i++)
+			hor[i] = ~uint64_t(0);
+		if(width % 64)
+			hor[words - 1] = (uint64_t(1) << width % 64) - 1;
 
-	int matrix_surrounding(const matrix_cell<bool> &cell) {
-		return
-			cell.left ()() << 3 |
-			cell.right()() << 2 |
-			cell.up   ()() << 1 |
-			cell.down ()();
-	};
+		for(int i = 0; i < width - 1; i++)
+			if(!(last || maze::rand(2)) || !now.join(i, i + 1))
+				vert[(i + 1)/64] |= uint64_t(1) << (i + 1) % 64;
+		if(last)
+			return;
 
-	bool vector_join(std::vector<int> &vec, int a, int b) {
-		const int aroot = maze::vector_find(vec, a), broot = maze::vector_find(vec, b);
-		if(aroot == broot)
-			return false;
-		vec[broot] = aroot;
-		return true;
+		// thread the cells of each set into a list headed at its root, in
+		// increasing column order; sets are visited by their leftmost cell
+		for(int i = width - 1; i >= 0; i--) {
+			const int root = now.find(i);
+			link[i] = head[root];
+			head[root] = i;
+		}
+		for(int i = 0; i < width; i++) {
+			const int root = now.find(i);
+			if(head[root] != i)
+				continue;
+
+			int selected = -1;
+			while(selected == -1)
+				for(int j = head[root]; j != -1; j = link[j])
+					if(maze::rand(2)) {
+						if(selected == -1)
+							selected = j;
+						next.join(selected, j);
+						hor[j/64] &= ~(uint64_t(1) << j % 64);
+					}
+			head[root] = -1;
+		}
+	}
+	const uint64_t *eller_stream::sides() const {
+		return vert.data();
+	}
+	const uint64_t *eller_stream::below() const {
+		return hor.data();
 	}
-	int vector_find(std::vector<int> &vec, int a) {
-		int &r = vec[a];
-		return r == a ? a : (r = maze::vector_find(vec, r));
+	std::size_t eller_stream::sidesWords() const {
+		return vert.size();
+	}
+	std::size_t eller_stream::belowWords() const {
+		return hor.size();
 	}
 
-	maze::structure aldousBroder(int w, int h) {
-		maze::structure maze(w, h);
-		int
-			x = maze::rand(w), y = maze::rand(h),
-			remaining = w*h - 1;
-		maze::matrix<bool> visited = maze.matrix(false, false);
-		visited(x, y)(true);
+	workspace::workspace():
+		result(0, 0),
+		visited(0, 0, false), frontier(0, 0, false),
+		set(0), shared_set(0), stream(0) {}
+	maze::structure &workspace::reset(int w, int h, bool init_value) {
+		MAZE_PHASE(allocate);
+		result.reset(w, h, init_value);
+		return result;
+	}
+
+	void aldousBroder(maze::workspace &ws, int w, int h) {
+		maze::structure &maze = ws.reset(w, h);
+		maze::bitplane &visited = ws.visited;
+		visited.reset(w, h, false);
+		int x = maze::rand(w), y = maze::rand(h);
+		uint64_t remaining = uint64_t(w)*h - 1;
+
+		visited.set(x, y, true);
 		while(remaining) {
-			bool newCell = false;
-			maze::cell here = maze(x, y);
+			MAZE_COUNT(walk_steps, 1);
+			const maze::cell &here = maze(x, y);
+			maze::bitplane::iterator wall = here.down();
 			switch(maze::randbit(
 				(x > 0)      << 3 |
 				(x < w - 1)  << 2 |
@@ -198,379 +421,809 @@ namespace maze {
 				(y < h - 1)
 			)) {
 				case 3:
-					if(!visited(--x, y)()) {
-						*here.left() = false;
-						newCell = true;
-					}
+					wall = here.left();
+					x--;
 				break;
 				case 2:
-					if(!visited(++x, y)()) {
-						*here.right() = false;
-						newCell = true;
-					}
+					wall = here.right();
+					x++;
 				break;
 				case 1:
-					if(!visited(x, --y)()) {
-						*here.up() = false;
-						newCell = true;
-					}
+					wall = here.up();
+					y--;
 				break;
 				case 0:
-					if(!visited(x, ++y)()) {
-						*here.down() = false;
-						newCell = true;
-					}
+					y++;
 				break;
 			}
-			if(newCell) {
-				visited(x, y)(true);
+			if(!visited.get(x, y)) {
+				*wall = false;
+				visited.set(x, y, true);
 				remaining--;
 			}
 		}
-		return maze;
 	}
-	maze::structure binaryTree(int w, int h) {
-		maze::structure maze(w, h);
-		for(int i = 0; i < w; i++)
-			for(int j = 0; j < h; j++) {
-				if(!i && !j)
-					continue;
-
-				bool dir = false;
-				if(i && j)
-					dir = rand(2);
-				else if(!i)
-					dir = true;
-
-				*(dir ? maze(i, j).up() : maze(i, j).left()) = false;
+	void binaryTree(maze::workspace &ws, int w, int h) {
+		maze::structure &maze = ws.reset(w, h);
+		for(int i = 1; i < w; i++)
+			*maze(i, 0).left() = false;
+		maze::parallel_for(1, h, [&](int from, int to) {
+			for(int i = from; i < to; i++) {
+				maze::philox engine = maze::stream(i);
+				*maze(0, i).up() = false;
+				for(int j = 1; j < w; j++)
+					*(maze::rand(engine, 2) ? maze(j, i).up() : maze(j, i).left()) = false;
 			}
-		
-		return maze;
+		});
 	}
-	maze::structure eller(int w, int h) {
-		maze::structure maze(w, h);
-		std::vector<int> now(w), next(w);
-		for(int i = 0; i < w; i++)
-			next[i] = i;
-		for(int i = 0; i < h - 1; i++) {
-			now.swap(next);
-			for(int j = 0; j < w; j++)
-				next[j] = j;
-			
-			for(int j = 0; j < w - 1; j++)
-				if(maze::rand(2) && maze::vector_join(now, j, j + 1)) {
-					*maze(j, i).right() = false;
+	// same maze as binaryTree, built 64 cells at a time: bit x of a row's
+	// random stream decides whether cell x + 1 carves up or left
+	void binaryTreeBitwise(maze::workspace &ws, int w, int h) {
+		maze::structure &maze = ws.reset(w, h);
+		maze::bitplane &hor = maze.horizontal(), &vert = maze.vertical();
+		const std::size_t words = hor.words();
+		const uint64_t last = w % 64 ? (uint64_t(1) << w % 64) - 1 : ~uint64_t(0);
+
+		for(std::size_t i = 0; i < vert.words(); i++)
+			vert.row(0)[i] = 0;
+		vert.set(0, 0, true);
+		vert.set(w, 0, true);
+		maze::parallel_for(1, h, [&](int from, int to) {
+			for(int i = from; i < to; i++) {
+				maze::philox engine = maze::stream(i);
+				uint64_t *above = hor.row(i), *sides = vert.row(i), carry = 1;
+				for(std::size_t j = 0; j < words; j++) {
+					const uint64_t r = j*64 + 1 < std::size_t(w) ? engine() : 0;
+					const uint64_t up = r << 1 | carry;
+					carry = r >> 63;
+					above[j] = ~up & (j == words - 1 ? last : ~uint64_t(0));
+					sides[j] = up & (j == words - 1 ? last : ~uint64_t(0));
 				}
-			
-			matrix_t<int> setlist(w);
-			for(int j = 0; j < w; j++)
-				setlist[maze::vector_find(now, j)].push_back(j);
-			for(const std::vector<int> &j: setlist) {
-				int selected = -1;
-				if(!j.size())
-					continue;
-				
-				while(selected == -1)
-					for(int k: j)
-						if(maze::rand(2)) {
-							if(selected == -1)
-								selected = k;
-							next[k] = selected;
-							*maze(k, i).down() = false;
-						}
+				vert.set(w, i, true);
 			}
+		});
+	}
+	void eller(maze::workspace &ws, int w, int h) {
+		maze::structure &maze = ws.reset(w, h);
+		maze::eller_stream &stream = ws.stream;
+		stream.reset(w);
+		for(int i = 0; i < h; i++) {
+			stream.advance(i == h - 1);
+			std::copy(stream.sides(), stream.sides() + stream.sidesWords(), maze.vertical().row(i));
+			if(i < h - 1)
+				std::copy(stream.below(), stream.below() + stream.belowWords(), maze.horizontal().row(i + 1));
 		}
-
-		for(int i = 0; i < w - 1; i++)
-			if(maze::vector_join(next, i, i + 1))
-				*maze(i, h - 1).right() = false;
-		
-		return maze;
 	}
-	maze::structure huntAndKill(int w, int h) {
-		maze::structure maze(w, h);
-		int remaining = w*h - 1;
-		maze::matrix<bool> visited = maze.matrix(false, true);
+	// the hunt phase reads from an index of frontier cells (unvisited cells next
+	// to visited ones) kept as a bitmap plus one summary bit per nonempty row,
+	// so each hunt costs O((w + h)/64) instead of a scan of the whole maze
+	void huntAndKill(maze::workspace &ws, int w, int h) {
+		maze::structure &maze = ws.reset(w, h);
+		uint64_t remaining = uint64_t(w)*h - 1;
+		maze::bitplane &visited = ws.visited, &frontier = ws.frontier;
+		std::vector<uint32_t> &count = ws.cells;
+		std::vector<uint64_t> &rows = ws.words;
+		visited.reset(w, h, false);
+		frontier.reset(w, h, false);
+		count.assign(h, 0);
+		rows.assign((h + 63)/64, 0);
+
+		auto mark = [&](int x, int y) {
+			if(x < 0 || x >= w || y < 0 || y >= h || visited.get(x, y) || frontier.get(x, y))
+				return;
+			frontier.set(x, y, true);
+			if(!count[y]++)
+				rows[y/64] |= uint64_t(1) << y % 64;
+		};
+		auto visit = [&](int x, int y) {
+			visited.set(x, y, true);
+			if(frontier.get(x, y)) {
+				frontier.set(x, y, false);
+				if(!--count[y])
+					rows[y/64] &= ~(uint64_t(1) << y % 64);
+			}
+			mark(x - 1, y);
+			mark(x + 1, y);
+			mark(x, y - 1);
+			mark(x, y + 1);
+		};
+		// bit 3..0: whether the left/right/up/down neighbor is in range and visited
+		auto around = [&](int x, int y) {
+			return
+				(x > 0     && visited.get(x - 1, y)) << 3 |
+				(x < w - 1 && visited.get(x + 1, y)) << 2 |
+				(y > 0     && visited.get(x, y - 1)) << 1 |
+				(y < h - 1 && visited.get(x, y + 1));
+		};
+		auto inside = [&](int x, int y) {
+			return (x > 0) << 3 | (x < w - 1) << 2 | (y > 0) << 1 | (y < h - 1);
+		};
+		auto carve = [&](int &x, int &y, int dir) {
+			const maze::cell &pos = maze(x, y);
+			switch(dir) {
+				case 3:
+					*pos.left() = false;
+					x--;
+				break;
+				case 2:
+					*pos.right() = false;
+					x++;
+				break;
+				case 1:
+					*pos.up() = false;
+					y--;
+				break;
+				case 0:
+					*pos.down() = false;
+					y++;
+				break;
+			}
+		};
 
 		int x = maze::rand(w), y = maze::rand(h);
-		visited(x, y)(true);
+		visit(x, y);
 		while(remaining) {
-			const maze::matrix_cell<bool> &here = visited(x, y);
-			int dir = matrix_surrounding(here) ^ 0xf;
-			here(true);
-
+			const int dir = ~around(x, y) & inside(x, y);
 			if(dir) {
-				const maze::cell &pos = maze(x, y);
-				switch(maze::randbit(dir)) {
-					case 3:
-						*pos.left() = false;
-						x--;
-					break;
-					case 2:
-						*pos.right() = false;
-						x++;
-					break;
-					case 1:
-						*pos.up() = false;
-						y--;
-					break;
-					case 0:
-						*pos.down() = false;
-						y++;
-					break;
-				}
-				visited(x, y)(true);
-				remaining--;
+				carve(x, y, maze::randbit(dir));
 			} else {
-				x = -1;
-				for(int i = 0; i < w && x == -1; i++)
-					for(int j = 0; j < h && x == -1; j++)
-						if(visited(i, j)() && matrix_surrounding(visited(i, j)) != 0xf) {
-							x = i;
-							y = j;
-						}
+				std::size_t i = 0;
+				while(!rows[i])
+					i++;
+				y = i*64 + __builtin_ctzll(rows[i]);
+				MAZE_COUNT(hunts, 1);
+				MAZE_COUNT(hunt_words, i + 1);
+				const uint64_t *r = frontier.row(y);
+				for(i = 0; !r[i]; i++);
+				x = i*64 + __builtin_ctzll(r[i]);
+				MAZE_COUNT(hunt_words, i + 1);
+
+				int hx = x, hy = y;
+				carve(hx, hy, maze::randbit(around(x, y)));
 			}
+			visit(x, y);
+			remaining--;
 		}
-
-		return maze;
 	}
-	maze::structure kruskal(int w, int h) {
-		using edge = std::tuple<bool, int, int>;
-
-		maze::structure maze(w, h);
-		maze::disjoint_set ds = maze.disjoint_set();
-		std::vector<edge> edgeset;
-		edgeset.reserve(2*w*h - w - h);
+	// edge 2*c is the right wall of cell c, edge 2*c + 1 its bottom wall
+	void kruskal(maze::workspace &ws, int w, int h) {
+		maze::structure &maze = ws.reset(w, h);
+		maze::disjoint_set &ds = ws.set;
+		std::vector<uint64_t> &edgeset = ws.words;
+		ds.reset(uint32_t(w)*h, true);
+		edgeset.clear();
+		edgeset.reserve(2*std::size_t(w)*h - w - h);
 		for(int i = 0; i < w; i++)
 			for(int j = 0; j < h - 1; j++)
-				edgeset.emplace_back(false, i, j);
+				edgeset.push_back(2*(uint64_t(j)*w + i) + 1);
 		for(int i = 0; i < w - 1; i++)
 			for(int j = 0; j < h; j++)
-				edgeset.emplace_back(true, i, j);
-		std::shuffle(edgeset.begin(), edgeset.end(), maze::random_engine);
-
-		for(const edge &i: edgeset) {
-			const int x = std::get<1>(i), y = std::get<2>(i);
-			const bool vert = std::get<0>(i);
-			const coord from(x, y), to(x + vert, y + !vert);
-			if(ds.join(from, to))
-				*(vert ? maze(from).right() : maze(from).down()) = false;
+				edgeset.push_back(2*(uint64_t(j)*w + i));
+		// Fisher-Yates on maze::rand, so the order only depends on the seed;
+		// more edges than an int holds take a 64-bit bounded draw instead
+		for(std::size_t i = edgeset.size(); i > 1; i--) {
+			const std::size_t j = i <= std::size_t(std::numeric_limits<int>::max()) ? maze::rand(i) : maze::rand64(i);
+			std::swap(edgeset[i - 1], edgeset[j]);
 		}
 
-		return maze;
+		for(const uint64_t i: edgeset) {
+			const uint32_t from = i/2;
+			const int x = from % w, y = from/w;
+			if(ds.join(from, i % 2 ? from + w : from + 1))
+				*(i % 2 ? maze(x, y).down() : maze(x, y).right()) = false;
+		}
 	}
-	maze::structure prim(int w, int h) {
-		using edge = std::tuple<bool, int, int>;
+	// Boruvka rounds over edges ranked by a seeded hash; with distinct ranks the
+	// minimum spanning tree is unique, so the maze only depends on the seed and
+	// is exactly what sequential Kruskal would build from the same ranking.
+	// Edge 2*c is the right wall of cell c, edge 2*c + 1 its bottom wall
+	template<class edge_t> void boruvka(maze::workspace &ws, int w, int h, std::vector<edge_t> &best) {
+		const edge_t none = std::numeric_limits<edge_t>::max();
+		const uint32_t cells = uint32_t(w)*h;
 
-		maze::structure maze(w, h);
-		maze::matrix<bool> visited = maze.matrix(false, true);
-		std::vector<edge> edgeset;
-		edgeset.emplace_back(false, maze::rand(w), maze::rand(h));
-		bool init = true;
-		
-		while(!edgeset.empty()) {
-			int sz = edgeset.size(), ix = maze::rand(sz);
-			std::swap(edgeset[ix], edgeset.back());
-			edge edge = edgeset.back();
-			edgeset.pop_back();
-
-			int px = std::get<1>(edge), py = std::get<2>(edge), x = px, y = py;
-			bool vert = std::get<0>(edge);
-
-			if(visited(x, y)())
-				vert ? x++ : y++;
-			if(visited(x, y)())
-				continue;
-			visited(x, y)(true);
-			
-			if(init)
-				init = false;
-			else
-				*(vert ? maze(px, py).right() : maze(px, py).down()) = false;
-			
-			if(!visited(x, y).left()())
-				edgeset.emplace_back(true, x - 1, y);
-			if(!visited(x, y).right()())
-				edgeset.emplace_back(true, x, y);
-			if(!visited(x, y).up()())
-				edgeset.emplace_back(false, x, y - 1);
-			if(!visited(x, y).down()())
-				edgeset.emplace_back(false, x, y);
+		maze::structure &maze = ws.reset(w, h);
+		maze::concurrent_disjoint_set &ds = ws.shared_set;
+		ds.reset(cells);
+		best.resize(cells);
+		const uint64_t key = maze::random_engine.getKey();
+		auto lighter = [key](edge_t a, edge_t b) {
+			const uint64_t ha = maze::hash(key, a), hb = maze::hash(key, b);
+			return ha < hb || (ha == hb && a < b);
+		};
+		auto propose = [&](uint32_t root, edge_t e) {
+			edge_t current = __atomic_load_n(&best[root], __ATOMIC_RELAXED);
+			while((current == none || lighter(e, current)) && !__atomic_compare_exchange_n(&best[root], &current, e, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+		};
+
+		bool merged = true;
+		while(merged) {
+			maze::parallel_for(0, h, [&](int from, int to) {
+				for(uint32_t i = uint32_t(from)*w; i < uint32_t(to)*w; i++)
+					__atomic_store_n(&best[i], none, __ATOMIC_RELAXED);
+			});
+			maze::parallel_for(0, h, [&](int from, int to) {
+				for(int y = from; y < to; y++)
+					for(int x = 0; x < w; x++) {
+						const uint32_t c = uint32_t(y)*w + x, root = ds.find(c);
+						if(x < w - 1) {
+							const uint32_t other = ds.find(c + 1);
+							if(root != other) {
+								propose(root, 2*edge_t(c));
+								propose(other, 2*edge_t(c));
+							}
+						}
+						if(y < h - 1) {
+							const uint32_t other = ds.find(c + w);
+							if(root != other) {
+								propose(root, 2*edge_t(c) + 1);
+								propose(other, 2*edge_t(c) + 1);
+							}
+						}
+					}
+			});
+
+			std::atomic<bool> any(false);
+			maze::parallel_for(0, h, [&](int from, int to) {
+				for(uint32_t i = uint32_t(from)*w; i < uint32_t(to)*w; i++) {
+					const edge_t e = __atomic_load_n(&best[i], __ATOMIC_RELAXED);
+					if(e == none)
+						continue;
+					const uint32_t c = e/2, x = c % w, y = c/w;
+					ds.join(c, e % 2 ? c + w : c + 1);
+					if(e % 2)
+						maze.horizontal().setAtomic(x, y + 1, false);
+					else
+						maze.vertical().setAtomic(x + 1, y, false);
+					any.store(true, std::memory_order_relaxed);
+				}
+			});
+			merged = any;
 		}
+	}
+	void kruskalParallel(maze::workspace &ws, int w, int h) {
+		if(2*uint64_t(w)*h <= std::numeric_limits<uint32_t>::max())
+			maze::boruvka(ws, w, h, ws.cells);
+		else
+			maze::boruvka(ws, w, h, ws.words);
+	}
+	// the frontier is a dense array of cells plus each cell's position in it,
+	// so a random frontier cell is picked and removed in O(1) and no cell is
+	// ever queued twice
+	void prim(maze::workspace &ws, int w, int h) {
+		const uint32_t none = std::numeric_limits<uint32_t>::max();
+
+		maze::structure &maze = ws.reset(w, h);
+		maze::bitplane &visited = ws.visited;
+		std::vector<uint32_t> &frontier = ws.cells, &position = ws.position;
+		visited.reset(w, h, false);
+		frontier.clear();
+		frontier.reserve(std::size_t(w)*h);
+		position.assign(uint32_t(w)*h, none);
+
+		auto add = [&](int x, int y) {
+			const uint32_t c = uint32_t(y)*w + x;
+			if(x < 0 || x >= w || y < 0 || y >= h || visited.get(x, y) || position[c] != none)
+				return;
+			position[c] = frontier.size();
+			frontier.push_back(c);
+			MAZE_PEAK(frontier_peak, frontier.size());
+		};
+		auto visit = [&](int x, int y) {
+			visited.set(x, y, true);
+			add(x - 1, y);
+			add(x + 1, y);
+			add(x, y - 1);
+			add(x, y + 1);
+		};
+
+		visit(maze::rand(w), maze::rand(h));
+		while(!frontier.empty()) {
+			const uint32_t ix = maze::rand(frontier.size()), c = frontier[ix];
+			frontier[ix] = frontier.back();
+			position[frontier[ix]] = ix;
+			frontier.pop_back();
+			position[c] = none;
 
-		return maze;
+			const int x = c % w, y = c/w;
+			const maze::cell &pos = maze(x, y);
+			switch(maze::randbit(
+				(x > 0     && visited.get(x - 1, y)) << 3 |
+				(x < w - 1 && visited.get(x + 1, y)) << 2 |
+				(y > 0     && visited.get(x, y - 1)) << 1 |
+				(y < h - 1 && visited.get(x, y + 1))
+			)) {
+				case 3:
+					*pos.left() = false;
+				break;
+				case 2:
+					*pos.right() = false;
+				break;
+				case 1:
+					*pos.up() = false;
+				break;
+				case 0:
+					*pos.down() = false;
+				break;
+			}
+			visit(x, y);
+		}
 	}
-	maze::structure recursiveBacktracker(int w, int h) {
-		maze::structure maze(w, h);
-		std::stack<coord> history;
-		maze::matrix<bool> visited = maze.matrix(false, true);
+	// Prim's algorithm proper: every edge gets a random 8-bit weight and the
+	// lightest edge out of the tree is taken next, from a bucket queue with one
+	// bucket per weight and a 256-bit mask of the nonempty ones. Edges are
+	// cell*4 + direction (3 left, 2 right, 1 up, 0 down) from the tree side.
+	// Each bucket is a stack of blocks from one pool, a block being the one
+	// below it and 63 edges; every block but the top one is full, so the pool
+	// is reserved up front for every edge and emptied blocks are reused
+	void truePrim(maze::workspace &ws, int w, int h) {
+		const uint64_t none = std::numeric_limits<uint64_t>::max(), block = 64;
+		maze::structure &maze = ws.reset(w, h);
+		maze::bitplane &visited = ws.visited;
+		std::vector<uint64_t> &pool = ws.words;
+		uint64_t top[256], fill[256], nonempty[4] = {0, 0, 0, 0}, spare = none;
+		visited.reset(w, h, false);
+		pool.clear();
+		pool.reserve(block*((2*uint64_t(w)*h - w - h)/(block - 1) + 256));
+		std::fill(top, top + 256, none);
 
-		history.emplace(maze::rand(w), maze::rand(h));
-		while(!history.empty()) {
-			const coord pos = history.top();
-			const maze::matrix_cell<bool> &here = visited(pos);
-			int dir = matrix_surrounding(here) ^ 0xf;
+		auto visit = [&](int x, int y) {
+			visited.set(x, y, true);
+			const int dir =
+				(x > 0     && !visited.get(x - 1, y)) << 3 |
+				(x < w - 1 && !visited.get(x + 1, y)) << 2 |
+				(y > 0     && !visited.get(x, y - 1)) << 1 |
+				(y < h - 1 && !visited.get(x, y + 1));
+			for(int i = 0; i < 4; i++)
+				if(dir & 1 << i) {
+					const int weight = maze::rand(256);
+					if(top[weight] == none || fill[weight] == block - 1) {
+						uint64_t fresh = spare;
+						if(fresh == none) {
+							fresh = pool.size();
+							pool.resize(fresh + block);
+						} else
+							spare = pool[fresh];
+						pool[fresh] = top[weight];
+						top[weight] = fresh;
+						fill[weight] = 0;
+					}
+					pool[top[weight] + ++fill[weight]] = (uint64_t(y)*w + x)*4 + i;
+					nonempty[weight/64] |= uint64_t(1) << weight % 64;
+				}
+		};
+
+		visit(maze::rand(w), maze::rand(h));
+		while(true) {
+			int i = 0;
+			while(i < 4 && !nonempty[i])
+				i++;
+			if(i == 4)
+				break;
+			const int weight = i*64 + __builtin_ctzll(nonempty[i]);
+			const uint64_t edge = pool[top[weight] + fill[weight]--];
+			if(!fill[weight]) {
+				const uint64_t empty = top[weight];
+				top[weight] = pool[empty];
+				pool[empty] = spare;
+				spare = empty;
+				fill[weight] = block - 1;
+				if(top[weight] == none)
+					nonempty[i] &= ~(uint64_t(1) << weight % 64);
+			}
+
+			int x = edge/4 % w, y = edge/4/w;
+			const maze::cell &pos = maze(x, y);
+			switch(edge % 4) {
+				case 3:
+					if(visited.get(--x, y))
+						continue;
+					*pos.left() = false;
+				break;
+				case 2:
+					if(visited.get(++x, y))
+						continue;
+					*pos.right() = false;
+				break;
+				case 1:
+					if(visited.get(x, --y))
+						continue;
+					*pos.up() = false;
+				break;
+				case 0:
+					if(visited.get(x, ++y))
+						continue;
+					*pos.down() = false;
+				break;
+			}
+			visit(x, y);
+		}
+	}
+	// the stack holds 2-bit directions instead of coordinates: each step is
+	// undone by moving back against the direction on top
+	void recursiveBacktracker(maze::workspace &ws, int w, int h) {
+		maze::structure &maze = ws.reset(w, h);
+		maze::bitplane &visited = ws.visited;
+		std::vector<uint64_t> &history = ws.words;
+		uint64_t depth = 0;
+		visited.reset(w, h, false);
+		history.clear();
+		history.reserve(std::size_t(w)*h/32 + 1);
+
+		// y is drawn first, as the old history.emplace(rand(w), rand(h)) did under GCC
+		int y = maze::rand(h), x = maze::rand(w);
+		while(true) {
+			visited.set(x, y, true);
+			const int dir =
+				(x > 0     && !visited.get(x - 1, y)) << 3 |
+				(x < w - 1 && !visited.get(x + 1, y)) << 2 |
+				(y > 0     && !visited.get(x, y - 1)) << 1 |
+				(y < h - 1 && !visited.get(x, y + 1));
 
-			here(true);
 			if(dir) {
-				const maze::cell &mazePos = maze(pos);
-				switch(maze::randbit(dir)) {
+				const maze::cell &mazePos = maze(x, y);
+				const int step = maze::randbit(dir);
+				switch(step) {
 					case 3:
 						*mazePos.left() = false;
-						history.emplace(pos.first - 1, pos.second);
+						x--;
 					break;
 					case 2:
 						*mazePos.right() = false;
-						history.emplace(pos.first + 1, pos.second);
+						x++;
 					break;
 					case 1:
 						*mazePos.up() = false;
-						history.emplace(pos.first, pos.second - 1);
+						y--;
 					break;
 					case 0:
 						*mazePos.down() = false;
-						history.emplace(pos.first, pos.second + 1);
+						y++;
+					break;
+				}
+				if(depth % 32 == 0)
+					history.push_back(0);
+				history.back() |= uint64_t(step) << depth % 32*2;
+				depth++;
+				MAZE_PEAK(stack_peak, depth);
+			} else {
+				if(!depth)
+					break;
+				depth--;
+				const int step = history[depth/32] >> depth % 32*2 & 3;
+				history[depth/32] &= ~(uint64_t(3) << depth % 32*2);
+				if(depth % 32 == 0)
+					history.pop_back();
+				switch(step) {
+					case 3:
+						x++;
+					break;
+					case 2:
+						x--;
+					break;
+					case 1:
+						y++;
+					break;
+					case 0:
+						y--;
 					break;
 				}
-			} else
-				history.pop();
+			}
 		}
-
-		return maze;
 	}
-	maze::structure recursiveDivision(int w, int h) {
+	// every region draws from its own stream, keyed by its rectangle, so the
+	// maze doesn't depend on the order regions are processed in; large regions
+	// are split across threads, small ones finish in a sequential kernel
+	void recursiveDivision(maze::workspace &ws, int w, int h) {
 		using args = std::tuple<int, int, int, int>;
-		maze::structure maze(w, h, false);
-		std::queue<args> queue;
-		queue.emplace(0, 0, w, h);
-		while(!queue.empty()) {
+		const int cutoff = 1 << 14;
+		const bool shared = maze::getConcurrency() > 1;
+
+		maze::structure &maze = ws.reset(w, h, false);
+		maze::bitplane &hor = maze.horizontal(), &vert = maze.vertical();
+		auto wall = [&](maze::bitplane &plane, int x, int y) {
+			if(shared)
+				plane.setAtomic(x, y, true);
+			else
+				plane.set(x, y, true);
+		};
+		// divides one region and returns the two halves
+		auto divide = [&](const args &region, args &first, args &second) {
 			const int
-				x = std::get<0>(queue.front()), y = std::get<1>(queue.front()),
-				w = std::get<2>(queue.front()), h = std::get<3>(queue.front());
-			queue.pop();
-			
-			if(w == 1 || h == 1)
-				continue;
-			
-			int divSpots = w + h - 2, divSpot = maze::rand(divSpots);
+				x = std::get<0>(region), y = std::get<1>(region),
+				w = std::get<2>(region), h = std::get<3>(region);
+			maze::philox engine = maze::stream(uint64_t(x) << 48 | uint64_t(y) << 32 | uint64_t(w) << 16 | h);
+
+			int divSpots = w + h - 2, divSpot = maze::rand(engine, divSpots);
 			if(divSpot >= h - 1) {
-				int t = divSpot - h + 1, hole = maze::rand(h);
+				int t = divSpot - h + 1, hole = maze::rand(engine, h);
 				for(int i = 0; i < h; i++)
 					if(i != hole)
-						*maze(x + t, y + i).right() = true;
+						wall(vert, x + t + 1, y + i);
 				t++;
-				queue.emplace(x, y, t, h);
-				queue.emplace(x + t, y, w - t, h);
+				first = args(x, y, t, h);
+				second = args(x + t, y, w - t, h);
 			} else {
-				int t = divSpot, hole = maze::rand(w);
+				int t = divSpot, hole = maze::rand(engine, w);
 				for(int i = 0; i < w; i++)
 					if(i != hole)
-						*maze(x + i, y + t).down() = true;
+						wall(hor, x + i, y + t + 1);
 				t++;
-				queue.emplace(x, y, w, t);
-				queue.emplace(x, y + t, w, h - t);
+				first = args(x, y, w, t);
+				second = args(x, y + t, w, h - t);
+			}
+		};
+		auto sequential = [&](const args &region, std::vector<args> &stack) {
+			stack.assign(1, region);
+			while(!stack.empty()) {
+				const args top = stack.back();
+				stack.pop_back();
+				if(std::get<2>(top) == 1 || std::get<3>(top) == 1)
+					continue;
+				args first, second;
+				divide(top, first, second);
+				stack.push_back(second);
+				stack.push_back(first);
+				MAZE_PEAK(stack_peak, stack.size());
 			}
+		};
+
+		if(!shared) {
+			ws.regions.reserve(std::size_t(w) + h);
+			sequential(args(0, 0, w, h), ws.regions);
+			return;
 		}
-		return maze;
+		std::function<void(const args &, maze::task_pool &, int)> split = [&](const args &region, maze::task_pool &tasks, int worker) {
+			if(uint64_t(std::get<2>(region))*std::get<3>(region) <= cutoff) {
+				std::vector<args> stack;
+				sequential(region, stack);
+				return;
+			}
+			args first, second;
+			divide(region, first, second);
+			tasks.spawn(worker, [&, second](maze::task_pool &tasks, int worker) {
+				split(second, tasks, worker);
+			});
+			split(first, tasks, worker);
+		};
+		maze::task_pool tasks;
+		tasks.run([&](maze::task_pool &tasks, int worker) {
+			split(args(0, 0, w, h), tasks, worker);
+		});
 	}
-	maze::structure sidewinder(int w, int h) {
-		maze::structure maze(w, h);
+	void sidewinder(maze::workspace &ws, int w, int h) {
+		maze::structure &maze = ws.reset(w, h);
 		for(int i = 1; i < w; i++)
 			*maze(i, 0).left() = false;
 		
-		for(int i = 1; i < h; i++) {
-			int r = 0;
-			for(int j = 0; j < w; j++) {
-				r++;
-				if(r != 1)
-					*maze(j, i).left() = false;
-				if(j == w - 1 || maze::rand(2)) {
-					*maze(j - r + maze::rand(r) + 1, i).up() = false;
-					r = 0;
+		maze::parallel_for(1, h, [&](int from, int to) {
+			for(int i = from; i < to; i++) {
+				maze::philox engine = maze::stream(i);
+				int r = 0;
+				for(int j = 0; j < w; j++) {
+					r++;
+					if(r != 1)
+						*maze(j, i).left() = false;
+					if(j == w - 1 || maze::rand(engine, 2)) {
+						*maze(j - r + maze::rand(engine, r) + 1, i).up() = false;
+						r = 0;
+					}
 				}
 			}
-		}
+		});
+	}
+	// bit x of a row's run word closes the run at cell x; each closed run
+	// then carves up from one of its cells. The run words are kept in the
+	// row's own side walls and shifted into place once the runs are carved
+	void sidewinderBitwise(maze::workspace &ws, int w, int h) {
+		maze::structure &maze = ws.reset(w, h);
+		maze::bitplane &hor = maze.horizontal(), &vert = maze.vertical();
+		const std::size_t words = hor.words();
 
-		return maze;
+		for(std::size_t i = 0; i < vert.words(); i++)
+			vert.row(0)[i] = 0;
+		vert.set(0, 0, true);
+		vert.set(w, 0, true);
+		maze::parallel_for(1, h, [&](int from, int to) {
+			for(int i = from; i < to; i++) {
+				maze::philox engine = maze::stream(i);
+				uint64_t *above = hor.row(i), *runs = vert.row(i);
+				for(std::size_t j = 0; j < words; j++)
+					runs[j] = engine();
+				if(w % 64)
+					runs[words - 1] &= (uint64_t(1) << w % 64) - 1;
+				runs[(w - 1)/64] |= uint64_t(1) << (w - 1) % 64;
+
+				int start = 0;
+				for(std::size_t j = 0; j < words; j++)
+					for(uint64_t t = runs[j]; t; t &= t - 1) {
+						const int end = j*64 + __builtin_ctzll(t), x = start + maze::rand(engine, end - start + 1);
+						above[x/64] &= ~(uint64_t(1) << x % 64);
+						start = end + 1;
+					}
+
+				if(vert.words() > words)
+					runs[words] = runs[words - 1] >> 63;
+				for(std::size_t j = words - 1; j > 0; j--)
+					runs[j] = runs[j] << 1 | runs[j - 1] >> 63;
+				runs[0] = runs[0] << 1 | 1;
+			}
+		});
 	}
-	maze::structure wilson(int w, int h) {
-		maze::structure maze(w, h);
-		maze::matrix<int> direction = maze.matrix(0, 0);
-		direction(0, 0)(4);
+	// Wilson's algorithm from the cells already in the tree: a random walk from
+	// each other cell remembers the last direction taken out of every cell it
+	// passes, 2 bits per cell, which erases loops for free; the walk is then
+	// replayed from its start and carved into the tree
+	void loopErasedWalks(maze::workspace &ws) {
+		maze::structure &maze = ws.result;
+		maze::bitplane &tree = ws.visited;
+		std::vector<uint64_t> &direction = ws.words;
+		const int w = maze.getWidth(), h = maze.getHeight();
+		direction.resize((uint64_t(w)*h + 31)/32);
+		auto step = [&](int &x, int &y, int dir) {
+			switch(dir) {
+				case 3:
+					x--;
+				break;
+				case 2:
+					x++;
+				break;
+				case 1:
+					y--;
+				break;
+				case 0:
+					y++;
+				break;
+			}
+		};
 
 		for(int i = 0; i < w; i++)
 			for(int j = 0; j < h; j++) {
-				if(direction(i, j)() == 4)
+				if(tree.get(i, j))
 					continue;
 				
 				int x = i, y = j;
-				while(direction(x, y)() != 4) {
-					int dir = maze::randbit(
+				while(!tree.get(x, y)) {
+					const uint64_t c = uint64_t(y)*w + x;
+					const int dir = maze::randbit(
 						(x > 0)      << 3 |
 						(x < w - 1)  << 2 |
 						(y > 0)      << 1 |
 						(y < h - 1)
 					);
-					direction(x, y)(dir);
-					switch(dir) {
-						case 3:
-							x--;
-						break;
-						case 2:
-							x++;
-						break;
-						case 1:
-							y--;
-						break;
-						case 0:
-							y++;
-						break;
-					}
+					direction[c/32] = (direction[c/32] & ~(uint64_t(3) << c % 32*2)) | uint64_t(dir) << c % 32*2;
+					step(x, y, dir);
+					MAZE_COUNT(walk_steps, 1);
+					MAZE_COUNT(loop_erasures, 1);
 				}
-				bool broken = false;
+				// every step that survives into the tree wasn't erased after all
 				x = i; y = j;
-				while(!broken) {
-					int dir = direction(x, y)();
-					if(dir == 4) {
-						broken = true;
-						break;
-					}
-
-					direction(x, y)(4);
+				while(!tree.get(x, y)) {
+					MAZE_COUNT(loop_erasures, -1);
+					const uint64_t c = uint64_t(y)*w + x;
+					const int dir = direction[c/32] >> c % 32*2 & 3;
+					const maze::cell &here = maze(x, y);
+					tree.set(x, y, true);
 					switch(dir) {
 						case 3:
-							*maze(x--, y).left() = false;
+							*here.left() = false;
 						break;
 						case 2:
-							*maze(x++, y).right() = false;
+							*here.right() = false;
 						break;
 						case 1:
-							*maze(x, y--).up() = false;
+							*here.up() = false;
 						break;
 						case 0:
-							*maze(x, y++).down() = false;
+							*here.down() = false;
 						break;
 					}
+					step(x, y, dir);
 				}
 			}
-		
-		return maze;
-	}
-	
-	std::map<std::string, maze::structure (*)(int, int)> algo{
-		std::make_pair("aldous-broder", aldousBroder),
-		std::make_pair("binary-tree", binaryTree),
-		std::make_pair("eller", eller),
-		std::make_pair("hunt-and-kill", huntAndKill),
-		std::make_pair("kruskal", kruskal),
-		std::make_pair("prim", prim),
-		std::make_pair("recursive-backtracker", recursiveBacktracker),
-		std::make_pair("recursive-division", recursiveDivision),
-		std::make_pair("sidewinder", sidewinder),
-		std::make_pair("wilson", wilson)
+	}
+	void wilson(maze::workspace &ws, int w, int h) {
+		ws.reset(w, h);
+		ws.visited.reset(w, h, false);
+		ws.visited.set(0, 0, true);
+		maze::loopErasedWalks(ws);
+	}
+
+	template<void (*generate)(maze::workspace &, int, int)> maze::structure fresh(int w, int h) {
+		maze::workspace ws;
+		generate(ws, w, h);
+		return std::move(ws.result);
+	}
+	maze::structure aldousBroder(int w, int h) {
+		return fresh<maze::aldousBroder>(w, h);
+	}
+	maze::structure binaryTree(int w, int h) {
+		return fresh<maze::binaryTree>(w, h);
+	}
+	maze::structure binaryTreeBitwise(int w, int h) {
+		return fresh<maze::binaryTreeBitwise>(w, h);
+	}
+	maze::structure eller(int w, int h) {
+		return fresh<maze::eller>(w, h);
+	}
+	maze::structure huntAndKill(int w, int h) {
+		return fresh<maze::huntAndKill>(w, h);
+	}
+	maze::structure kruskal(int w, int h) {
+		return fresh<maze::kruskal>(w, h);
+	}
+	maze::structure kruskalParallel(int w, int h) {
+		return fresh<maze::kruskalParallel>(w, h);
+	}
+	maze::structure prim(int w, int h) {
+		return fresh<maze::prim>(w, h);
+	}
+	maze::structure truePrim(int w, int h) {
+		return fresh<maze::truePrim>(w, h);
+	}
+	maze::structure recursiveBacktracker(int w, int h) {
+		return fresh<maze::recursiveBacktracker>(w, h);
+	}
+	maze::structure recursiveDivision(int w, int h) {
+		return fresh<maze::recursiveDivision>(w, h);
+	}
+	maze::structure sidewinder(int w, int h) {
+		return fresh<maze::sidewinder>(w, h);
+	}
+	maze::structure sidewinderBitwise(int w, int h) {
+		return fresh<maze::sidewinderBitwise>(w, h);
+	}
+	maze::structure wilson(int w, int h) {
+		return fresh<maze::wilson>(w, h);
+	}
+
+	// h == 0 streams rows until the output is closed; rows counts the rows generated so far
+	template<class renderer_t> void streamRows(renderer_t &renderer, int w, uint_fast64_t h, uint_fast64_t &rows) {
+		maze::eller_stream stream(w);
+		maze::bitplane top(w, 1, true);
+
+		rows = 0;
+		renderer.horizontal(top.row(0));
+		while(!h || rows < h) {
+			const bool last = h && rows == h - 1;
+			{
+				MAZE_PHASE(generate);
+				stream.advance(last);
+			}
+			MAZE_PHASE(render);
+			renderer.vertical(stream.sides());
+			renderer.horizontal(last ? top.row(0) : stream.below());
+			rows++;
+		}
+		renderer.flush();
+	}
+	void streamEller(maze::sink out, int w, uint_fast64_t h, const std::string &wall, const std::string &blank, uint_fast64_t &rows) {
+		maze::text_renderer renderer(out, w, wall, blank);
+		maze::streamRows(renderer, w, h, rows);
+	}
+	// images need their height up front, so h must not be 0 here
+	void streamEller(maze::sink out, int w, uint_fast64_t h, const maze::image_style &style, uint_fast64_t &rows) {
+		maze::image_renderer renderer(out, w, style);
+		renderer.header(h);
+		maze::streamRows(renderer, w, h, rows);
+	}
+
+	std::map<std::string, void (*)(maze::workspace &, int, int)> algo{
+		{"aldous-broder", aldousBroder},
+		{"binary-tree", binaryTree},
+		{"binary-tree-bitwise", binaryTreeBitwise},
+		{"eller", eller},
+		{"hunt-and-kill", huntAndKill},
+		{"kruskal", kruskal},
+		{"kruskal-parallel", kruskalParallel},
+		{"prim", prim},
+		{"true-prim", truePrim},
+		{"recursive-backtracker", recursiveBacktracker},
+		{"recursive-division", recursiveDivision},
+		{"sidewinder", sidewinder},
+		{"sidewinder-bitwise", sidewinderBitwise},
+		{"wilson", wilson}
 	};
 	std::set<std::string> algo_is_slow{
-		"aldous-broder",
-		"wilson"
+		"aldous-broder"
 	};
 }
\ No newline at end of file
@@ -1,47 +1,130 @@
 #include <string>
 #include <vector>
+#include <cstdint>
+#include <cstddef>
 #include <set>
 #include <map>
-#include <chrono>
-#include <random>
 #include <utility>
+#include <memory>
+#include <atomic>
+#include <tuple>
+
+#include "maze_parallel.hpp"
+#include "maze_random.hpp"
+#include "maze_render.hpp"
 
 #ifndef MAZE_ALGORITHMS_INCLUDE_GUARD
 #define MAZE_ALGORITHMS_INCLUDE_GUARD
 
 namespace maze {
-	extern std::mt19937_64 random_engine;
-
-	void randinit(uint_fast64_t seed = std::chrono::duration_cast<std::chrono::microseconds>(
-		std::chrono::time_point_cast<std::chrono::microseconds>(
-			std::chrono::steady_clock::now()
-		).time_since_epoch()
-	).count());
-	int rand(int max);
-	int randbit(int bits);
-
+	class bitplane;
 	class structure;
 	class cell;
-	template<class T> class matrix;
 	class disjoint_set;
-	template<class T> class matrix_cell;
+	class concurrent_disjoint_set;
+	class eller_stream;
+	class workspace;
+
+	class bitplane {
+		int width, height;
+		std::size_t stride;
+		std::vector<uint64_t> data;
+		uint64_t *view;
+	public:
+		class reference {
+			friend class maze::bitplane;
+
+			uint64_t *word, mask;
+			reference(uint64_t *word_, uint64_t mask_);
+		public:
+			operator bool() const;
+			reference &operator=(bool value);
+			reference &operator=(const reference &other);
+		};
+		class iterator {
+			friend class maze::bitplane;
+
+			uint64_t *word, mask;
+			iterator(uint64_t *word_, uint64_t mask_);
+		public:
+			maze::bitplane::reference operator*() const;
+		};
+
+		bitplane(int w, int h, bool init_value);
+		bitplane(int w, int h, uint64_t *view_);
+		void reset(int w, int h, bool init_value);
+		bool get(int x, int y) const;
+		void set(int x, int y, bool value);
+		void setAtomic(int x, int y, bool value);
+		maze::bitplane::iterator at(int x, int y);
+		uint64_t *row(int y);
+		const uint64_t *row(int y) const;
+		std::size_t words() const;
+	};
 
 	class structure {
 		friend class maze::cell;
 
 		int width, height;
-		std::vector<std::vector<bool> > hor, vert;
+		maze::bitplane hor, vert;
 	public:
 		structure(int w, int h, bool init_value = true);
-		template<class T> maze::matrix<T> matrix(T val, T out) const;
-		maze::disjoint_set disjoint_set() const;
+		structure(int w, int h, uint64_t *hor_, uint64_t *vert_);
+		void reset(int w, int h, bool init_value = true);
+		int getWidth() const;
+		int getHeight() const;
+		maze::bitplane &horizontal();
+		maze::bitplane &vertical();
+		const maze::bitplane &horizontal() const;
+		const maze::bitplane &vertical() const;
+		// bit 3..0: whether (x, y) opens to the left/right/up/down; the border
+		// never opens outward, whatever its walls say
+		int openings(int x, int y) const;
+		// the same for the cells of word j of row y, 64 at a time: bit i of
+		// ways[0..3] is whether cell 64*j + i opens to the left/right/up/down.
+		// Returns which bits of the word are cells of the maze
+		uint64_t openings(int y, std::size_t j, uint64_t ways[4]) const;
+		maze::disjoint_set disjoint_set(bool packed = false) const;
 		maze::cell operator()(int x, int y);
 		maze::cell operator()(std::pair<int, int> pos);
+		void render(maze::sink out, const std::string &wall, const std::string &blank) const;
+		void render(maze::sink out, const maze::image_style &style) const;
+		void render(maze::sink out, const std::string &wall, const std::string &blank, const maze::bitplane &route, const std::string &path) const;
 		std::string toString(std::string &wall, std::string &blank);
+		std::string toString(const std::string &wall, const std::string &blank, const maze::bitplane &route, const std::string &path) const;
 	};
 
+	// searches ask for a wall or two per cell, so these are defined here to be
+	// inlined
+	inline uint64_t *bitplane::row(int y) {
+		return (view ? view : data.data()) + stride*y;
+	}
+	inline const uint64_t *bitplane::row(int y) const {
+		return (view ? view : data.data()) + stride*y;
+	}
+	inline bool bitplane::get(int x, int y) const {
+		return row(y)[x/64] >> x % 64 & 1;
+	}
+	inline void bitplane::set(int x, int y, bool value) {
+		uint64_t &word = row(y)[x/64];
+		word = (word & ~(uint64_t(1) << x % 64)) | uint64_t(value) << x % 64;
+	}
+	inline int structure::openings(int x, int y) const {
+		return
+			(x > 0          && !vert.get(x, y))     << 3 |
+			(x < width - 1  && !vert.get(x + 1, y)) << 2 |
+			(y > 0          && !hor.get(x, y))      << 1 |
+			(y < height - 1 && !hor.get(x, y + 1));
+	}
+	// moves (x, y) one cell the way of an openings() bit; dir ^ 1 goes back
+	inline void step(int &x, int &y, int dir) {
+		static const int dx[4] = {0, 0, 1, -1}, dy[4] = {1, -1, 0, 0};
+		x += dx[dir];
+		y += dy[dir];
+	}
+
 	class cell {
-		using it = std::vector<bool>::iterator;
+		using it = maze::bitplane::iterator;
 		friend class maze::structure;
 
 		maze::structure *from;
@@ -54,63 +137,104 @@ namespace maze {
 		it down() const;
 	};
 
-	template<class T> class matrix {
-		friend class maze::structure;
-		friend class maze::matrix_cell<T>;
-
-		int width, height;
-		T def;
-		std::vector<std::vector<T> > data;
-		matrix(int w, int h, T val, T out);
+	// union by rank with iterative path halving over flat cell indices (y*w + x);
+	// the packed variant keeps a root's rank in its own slot as
+	// UINT32_MAX - rank instead of in a separate array, for 4 bytes per cell
+	class disjoint_set {
+		std::vector<uint32_t> set;
+		std::vector<uint8_t> rank;
+		bool packed;
 	public:
-		maze::matrix_cell<T> operator()(int x, int y);
-		maze::matrix_cell<T> operator()(std::pair<int, int> pos);
+		disjoint_set(uint32_t n, bool packed_ = false);
+		void reset();
+		void reset(uint32_t n, bool packed_ = false);
+		bool join(uint32_t a, uint32_t b);
+		uint32_t find(uint32_t a);
 	};
 
-	class disjoint_set {
-		friend class maze::structure;
-		
-		int width, height;
-		std::vector<std::vector<std::pair<int, int> > > set;
-		disjoint_set(int w, int h);
+	// lock-free union-find over flat cell indices, safe to share between threads
+	class concurrent_disjoint_set {
+		std::vector<uint32_t> set;
 	public:
-		bool join(std::pair<int, int> a, std::pair<int, int> b);
-		std::pair<int, int> find(std::pair<int, int> a);
+		concurrent_disjoint_set(uint32_t n);
+		void reset(uint32_t n);
+		bool join(uint32_t a, uint32_t b);
+		uint32_t find(uint32_t a);
 	};
 
-	template<class T> class matrix_cell {
-		friend class maze::matrix<T>;
-
-		maze::matrix<T> *from;
-		int x, y;
-		matrix_cell(maze::matrix<T> *from_, int x_, int y_);
+	// generates an Eller maze one row at a time in O(width) memory;
+	// after each advance(), sides() holds the walls between the cells of
+	// the new row and below() the walls under it
+	class eller_stream {
+		int width;
+		std::size_t words;
+		maze::disjoint_set now, next;
+		std::vector<int> head, link;
+		std::vector<uint64_t> vert, hor;
 	public:
-		maze::matrix_cell<T> left() const;
-		maze::matrix_cell<T> right() const;
-		maze::matrix_cell<T> up() const;
-		maze::matrix_cell<T> down() const;
-		T operator()() const;
-		T operator()(T n) const;
+		eller_stream(int w);
+		void reset(int w);
+		void advance(bool last = false);
+		const uint64_t *sides() const;
+		const uint64_t *below() const;
+		std::size_t sidesWords() const;
+		std::size_t belowWords() const;
 	};
 
-	int matrix_surrounding(const matrix_cell<bool> &cell);
+	// caller-owned storage for repeated generation: the maze and the scratch
+	// buffers of every generator are reset in place, so once they have grown
+	// to the largest size asked for, generating again on one thread doesn't
+	// touch the heap; with more, the task pool and per-band scratch still do
+	class workspace {
+	public:
+		maze::structure result;
+		maze::bitplane visited, frontier;
+		maze::disjoint_set set;
+		maze::concurrent_disjoint_set shared_set;
+		maze::eller_stream stream;
+		std::vector<uint32_t> cells, position;
+		std::vector<uint64_t> words;
+		std::vector<std::tuple<int, int, int, int> > regions;
+		workspace();
+		maze::structure &reset(int w, int h, bool init_value = true);
+	};
 
-	bool vector_join(std::vector<int> &vec, int a, int b);
-	int vector_find(std::vector<int> &vec, int a);
+	void loopErasedWalks(maze::workspace &ws);
 
 	maze::structure aldousBroder(int w, int h);
+	void aldousBroder(maze::workspace &ws, int w, int h);
 	maze::structure binaryTree(int w, int h);
+	void binaryTree(maze::workspace &ws, int w, int h);
+	maze::structure binaryTreeBitwise(int w, int h);
+	void binaryTreeBitwise(maze::workspace &ws, int w, int h);
 	maze::structure eller(int w, int h);
+	void eller(maze::workspace &ws, int w, int h);
 	maze::structure huntAndKill(int w, int h);
+	void huntAndKill(maze::workspace &ws, int w, int h);
 	maze::structure kruskal(int w, int h);
+	void kruskal(maze::workspace &ws, int w, int h);
+	maze::structure kruskalParallel(int w, int h);
+	void kruskalParallel(maze::workspace &ws, int w, int h);
 	maze::structure prim(int w, int h);
+	void prim(maze::workspace &ws, int w, int h);
+	maze::structure truePrim(int w, int h);
+	void truePrim(maze::workspace &ws, int w, int h);
 	maze::structure recursiveBacktracker(int w, int h);
+	void recursiveBacktracker(maze::workspace &ws, int w, int h);
 	maze::structure recursiveDivision(int w, int h);
+	void recursiveDivision(maze::workspace &ws, int w, int h);
 	maze::structure sidewinder(int w, int h);
+	void sidewinder(maze::workspace &ws, int w, int h);
+	maze::structure sidewinderBitwise(int w, int h);
+	void sidewinderBitwise(maze::workspace &ws, int w, int h);
 	maze::structure wilson(int w, int h);
+	void wilson(maze::workspace &ws, int w, int h);
+
+	void streamEller(maze::sink out, int w, uint_fast64_t h, const std::string &wall, const std::string &blank, uint_fast64_t &rows);
+	void streamEller(maze::sink out, int w, uint_fast64_t h, const maze::image_style &style, uint_fast64_t &rows);
 
 	extern std::set<std::string> algo_is_slow;
-	extern std::map<std::string, maze::structure (*)(int, int)> algo;
+	extern std::map<std::string, void (*)(maze::workspace &, int, int)> algo;
 }
 
 #endif
\ No newline at end of file
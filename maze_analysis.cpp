@@ -0,0 +1,216 @@
+#include <mutex>
+#include <sstream>
+#include <algorithm>
+
+#include "maze_analysis.hpp"
+#include "maze_parallel.hpp"
+
+namespace {
+	void add(maze::analysis &to, const maze::analysis &from) {
+		for(int i = 0; i < 5; i++)
+			to.degrees[i] += from.degrees[i];
+		to.straights += from.straights;
+		to.turns += from.turns;
+		for(int i = 0; i < 2; i++) {
+			to.runs[i] += from.runs[i];
+			to.passages[i] += from.passages[i];
+		}
+		to.deadEndCells += from.deadEndCells;
+		to.longestDeadEnd = std::max(to.longestDeadEnd, from.longestDeadEnd);
+	}
+
+	// counts the openings, corridors and dead ends of rows [from, to), 64
+	// cells at a time from the wall words
+	void local(const maze::structure &maze, int from, int to, maze::analysis &result) {
+		for(int i = from; i < to; i++) {
+			const uint64_t *above = i > 1 ? maze.horizontal().row(i - 1) : nullptr;
+			uint64_t carry = 0;
+			for(std::size_t j = 0; j < maze.horizontal().words(); j++) {
+				uint64_t ways[4];
+				const uint64_t cells = maze.openings(i, j, ways), l = ways[0], r = ways[1], u = ways[2], d = ways[3];
+				// the number of openings, bit-sliced
+				const uint64_t lr = l ^ r, ud = u ^ d;
+				const uint64_t ones = lr ^ ud, twos = (l & r) ^ (u & d) ^ (lr & ud), fours = l & r & u & d;
+				const uint64_t degree[5] = {
+					cells & ~ones & ~twos & ~fours, ones & ~twos, ~ones & twos, ones & twos, fours
+				};
+				for(int k = 0; k < 5; k++)
+					result.degrees[k] += __builtin_popcountll(degree[k]);
+				const uint64_t straight = degree[2] & ((l & r) | (u & d));
+				result.straights += __builtin_popcountll(straight);
+				result.turns += __builtin_popcountll(degree[2] & ~straight);
+
+				// a run starts at a passage whose cell before it has none
+				result.runs[0] += __builtin_popcountll(l & ~(l << 1 | carry));
+				result.passages[0] += __builtin_popcountll(l);
+				carry = l >> 63;
+				result.runs[1] += __builtin_popcountll(u & ~(above ? ~above[j] : 0));
+				result.passages[1] += __builtin_popcountll(u);
+
+				for(uint64_t ends = degree[1]; ends; ends &= ends - 1) {
+					int x = 64*j + __builtin_ctzll(ends), y = i;
+					const int first = maze.openings(x, y);
+					if(!first)
+						continue;
+					int dir = __builtin_ctz(first);
+					uint64_t length = 1;
+					while(true) {
+						maze::step(x, y, dir);
+						const int open = maze.openings(x, y) & ~(1 << (dir ^ 1));
+						if(open & (open - 1))
+							break;
+						length++;
+						if(!open)
+							break;
+						dir = __builtin_ctz(open);
+					}
+					result.deadEndCells += length;
+					result.longestDeadEnd = std::max(result.longestDeadEnd, length);
+				}
+			}
+		}
+	}
+
+	// one level-synchronous breadth-first search from (x, y). A level of a
+	// perfect maze rarely holds more than a few thousand cells, so small ones
+	// are expanded inline and only large ones are split into chunks for the
+	// thread pool, which claim cells with an atomic OR on the visited words. levels(depth,
+	// size) sees every level, found gets the depth of target, read off the
+	// visited words once a level is done, and the smallest y << 16 | x of the
+	// last level is returned
+	template<class F> uint32_t sweep(const maze::structure &maze, int w, int h, int x, int y, uint32_t target, uint64_t &found, const F &levels) {
+		const std::size_t chunk = 256;
+		std::vector<uint64_t> visited((uint64_t(w)*h + 63)/64);
+		std::vector<uint32_t> frontier{uint32_t(y) << 16 | x}, next;
+		std::mutex lock;
+		const uint64_t goal = uint64_t(target >> 16)*w + (target & 0xFFFF);
+		uint64_t depth = 0;
+		visited[(uint64_t(y)*w + x)/64] |= uint64_t(1) << (uint64_t(y)*w + x) % 64;
+		bool pending = frontier[0] != target;
+		if(!pending)
+			found = 0;
+
+		auto expand = [&](std::size_t from, std::size_t to, std::vector<uint32_t> &out, bool shared) {
+			for(std::size_t i = from; i < to; i++) {
+				const int cx = frontier[i] & 0xFFFF, cy = frontier[i] >> 16;
+				for(int open = maze.openings(cx, cy); open; open &= open - 1) {
+					int nx = cx, ny = cy;
+					maze::step(nx, ny, __builtin_ctz(open));
+					const uint64_t n = uint64_t(ny)*w + nx, mask = uint64_t(1) << n % 64;
+					if((shared ? __atomic_load_n(&visited[n/64], __ATOMIC_RELAXED) : visited[n/64]) & mask)
+						continue;
+					if(shared) {
+						if(__atomic_fetch_or(&visited[n/64], mask, __ATOMIC_RELAXED) & mask)
+							continue;
+					} else
+						visited[n/64] |= mask;
+					out.push_back(uint32_t(ny) << 16 | nx);
+				}
+			}
+		};
+
+		for(; ; depth++) {
+			levels(depth, frontier.size());
+			if(frontier.size() < 8*chunk || maze::getConcurrency() == 1)
+				expand(0, frontier.size(), next, false);
+			else
+				maze::parallel_for(0, (frontier.size() + chunk - 1)/chunk, [&](int from, int to) {
+					std::vector<uint32_t> claimed;
+					expand(from*chunk, std::min(to*chunk, frontier.size()), claimed, true);
+					std::lock_guard<std::mutex> held(lock);
+					next.insert(next.end(), claimed.begin(), claimed.end());
+				});
+			if(pending && visited[goal/64] >> goal % 64 & 1) {
+				found = depth + 1;
+				pending = false;
+			}
+			if(next.empty())
+				return *std::min_element(frontier.begin(), frontier.end());
+			std::swap(frontier, next);
+			next.clear();
+		}
+	}
+}
+
+namespace maze {
+	// runs both BFS sweeps from the top left cell and then from the farthest
+	// cell found; in a perfect maze the second one spans the diameter
+	maze::analysis analyze(const maze::structure &maze) {
+		const int w = maze.getWidth(), h = maze.getHeight();
+		maze::analysis result{w, h};
+		result.bucket = 1;
+		result.solution = maze::analysis::none;
+
+		std::mutex lock;
+		maze::parallel_for(0, h, [&](int from, int to) {
+			maze::analysis part{w, h};
+			local(maze, from, to, part);
+			std::lock_guard<std::mutex> held(lock);
+			add(result, part);
+		});
+
+		// distances fill at most 64 buckets, which double in width and merge
+		// pairwise whenever the next level doesn't fit
+		const uint32_t goal = uint32_t(h - 1) << 16 | (w - 1);
+		double sum = 0;
+		const uint32_t far = sweep(maze, w, h, 0, 0, goal, result.solution, [&](uint64_t depth, std::size_t size) {
+			while(depth/result.bucket >= 64) {
+				for(std::size_t i = 0; i < result.distances.size(); i++)
+					result.distances[i/2] = (i % 2 ? result.distances[i/2] : 0) + result.distances[i];
+				result.distances.resize((result.distances.size() + 1)/2);
+				result.bucket *= 2;
+			}
+			result.distances.resize(std::max<std::size_t>(result.distances.size(), depth/result.bucket + 1));
+			result.distances[depth/result.bucket] += size;
+			result.reachable += size;
+			sum += double(depth)*size;
+		});
+		result.meanDistance = sum/result.reachable;
+
+		result.ends[0] = far & 0xFFFF;
+		result.ends[1] = far >> 16;
+		uint64_t unused;
+		const uint32_t other = sweep(maze, w, h, result.ends[0], result.ends[1], far, unused, [&](uint64_t depth, std::size_t) {
+			result.diameter = depth;
+		});
+		result.ends[2] = other & 0xFFFF;
+		result.ends[3] = other >> 16;
+		return result;
+	}
+
+	std::string analysis::toJSON() const {
+		const uint64_t cells = uint64_t(width)*height, junctions = degrees[3] + degrees[4];
+		auto ratio = [](double a, double b) {
+			return b ? a/b : 0;
+		};
+		std::ostringstream out;
+		out
+			<< "{\"width\": " << width << ", \"height\": " << height << ", \"cells\": " << cells
+			<< ", \"dead_ends\": " << degrees[1] << ", \"dead_end_ratio\": " << ratio(degrees[1], cells)
+			<< ", \"junctions\": " << junctions << ", \"junction_ratio\": " << ratio(junctions, cells)
+			<< ", \"branching_factor\": " << ratio(2*degrees[3] + 3*degrees[4], junctions)
+			<< ", \"degrees\": [" << degrees[0] << ", " << degrees[1] << ", " << degrees[2] << ", " << degrees[3] << ", " << degrees[4] << "]"
+			<< ", \"straights\": " << straights << ", \"turns\": " << turns << ", \"turn_ratio\": " << ratio(turns, straights + turns)
+			<< ", \"straight_runs\": {";
+		for(int i = 0; i < 2; i++)
+			out
+				<< (i ? ", \"down\"" : "\"across\"") << ": {\"count\": " << runs[i]
+				<< ", \"mean_length\": " << ratio(passages[i] + runs[i], runs[i]) << "}";
+		out
+			<< "}, \"river_factor\": " << ratio(deadEndCells, degrees[1]) << ", \"longest_dead_end\": " << longestDeadEnd
+			<< ", \"solution_length\": ";
+		if(solution == none)
+			out << "null";
+		else
+			out << solution;
+		out
+			<< ", \"diameter\": " << diameter
+			<< ", \"diameter_ends\": [[" << ends[0] << ", " << ends[1] << "], [" << ends[2] << ", " << ends[3] << "]]"
+			<< ", \"reachable\": " << reachable << ", \"mean_distance\": " << meanDistance
+			<< ", \"distance_histogram\": {\"bucket\": " << bucket << ", \"counts\": [";
+		for(std::size_t i = 0; i < distances.size(); i++)
+			out << (i ? ", " : "") << distances[i];
+		out << "]}}";
+		return out.str();
+	}
+}
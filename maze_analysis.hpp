@@ -0,0 +1,43 @@
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "maze_algorithms.hpp"
+
+#ifndef MAZE_ANALYSIS_INCLUDE_GUARD
+#define MAZE_ANALYSIS_INCLUDE_GUARD
+
+namespace maze {
+	struct analysis;
+
+	// quality metrics of a maze; the local ones come from one parallel pass
+	// over the wall words, the distances from two breadth-first sweeps
+	struct analysis {
+		int width, height;
+		// cells by their number of openings; 1 is a dead end, 3 and 4 junctions
+		uint64_t degrees[5];
+		// cells with two openings, across from each other or at a corner
+		uint64_t straights, turns;
+		// maximal straight corridors, and the passages in them, across (0) and
+		// down (1)
+		uint64_t runs[2], passages[2];
+		// cells from each dead end up to the junction it hangs off
+		uint64_t deadEndCells, longestDeadEnd;
+		// cells reachable from the top left cell, by distance from it in
+		// buckets of bucket distances, at most 64 of them; the distance from
+		// there to the bottom right cell, or none; the longest path and its ends
+		uint64_t reachable, bucket;
+		std::vector<uint64_t> distances;
+		double meanDistance;
+		uint64_t solution, diameter;
+		int ends[4];
+
+		static const uint64_t none = UINT64_MAX;
+
+		std::string toJSON() const;
+	};
+
+	maze::analysis analyze(const maze::structure &maze);
+}
+
+#endif
@@ -0,0 +1,82 @@
+#include <sstream>
+#include <fstream>
+#include <algorithm>
+
+#include "maze_batch.hpp"
+#include "maze_algorithms.hpp"
+#include "maze_binary.hpp"
+#include "maze_stats.hpp"
+
+namespace maze {
+	// one job per line: algorithm width height seed; blank lines and lines
+	// starting with # are skipped
+	std::vector<maze::job> readManifest(std::istream &in) {
+		std::vector<maze::job> jobs;
+		std::string line;
+		for(int i = 1; std::getline(in, line); i++) {
+			std::istringstream fields(line);
+			maze::job job;
+			long long width, height;
+			std::string rest;
+			if(!(fields >> job.algo) || job.algo[0] == '#')
+				continue;
+			if(!(fields >> width >> height >> job.seed) || fields >> rest)
+				throw "malformed manifest line " + std::to_string(i);
+			if(!maze::algo.count(job.algo))
+				throw "unknown algorithm " + job.algo + " on manifest line " + std::to_string(i);
+			if(width < 1 || width > UINT16_MAX || height < 1 || height > UINT16_MAX)
+				throw "maze size on manifest line " + std::to_string(i) + " is out of its allowed range; try 1 to " + std::to_string(UINT16_MAX);
+			job.width = width;
+			job.height = height;
+			jobs.push_back(job);
+		}
+		return jobs;
+	}
+
+	// runs the jobs on the thread pool, each seeding its own thread's engine and
+	// generating into its own thread's workspace;
+	// if pattern is set, maze i goes to pattern with %d replaced by i, otherwise
+	// all mazes are written to out in job order, one round of jobs at a time
+	void runBatch(const std::vector<maze::job> &jobs, maze::sink out, const std::string &pattern, const std::string &format, const std::string &wall, const std::string &blank, const maze::image_style &image) {
+		const std::size_t round = 4*maze::getConcurrency();
+		std::vector<std::string> texts(std::min(round, jobs.size()));
+		std::vector<std::string> errors(texts.size());
+
+		for(std::size_t begin = 0; begin < jobs.size(); begin += round) {
+			const std::size_t count = std::min(round, jobs.size() - begin);
+			maze::pool().run(count, [&](int i) {
+				const maze::job &job = jobs[begin + i];
+				std::string &text = texts[i];
+				text.clear();
+				thread_local maze::workspace ws;
+				maze::randinit(job.seed);
+				{
+					MAZE_PHASE(generate);
+					maze::algo[job.algo](ws, job.width, job.height);
+				}
+				MAZE_PHASE(render);
+				if(format == "binary")
+					maze::writeBinary(text, ws.result, job.algo, job.seed);
+				else if(format == "pbm" || format == "pgm")
+					ws.result.render(text, image);
+				else
+					ws.result.render(text, wall, blank);
+				if(!pattern.size())
+					return;
+
+				std::string fname = pattern;
+				fname.replace(fname.find("%d"), 2, std::to_string(begin + i));
+				std::ofstream file(fname, std::ios::binary);
+				if(!file.is_open() || !file.write(text.data(), text.size()))
+					errors[i] = "couldn't write " + fname;
+			});
+
+			for(std::size_t i = 0; i < count; i++) {
+				if(errors[i].size())
+					throw errors[i];
+				if(!pattern.size())
+					out.write(texts[i].data(), texts[i].size());
+			}
+		}
+	}
+}
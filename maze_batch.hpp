@@ -0,0 +1,22 @@
+#include <string>
+#include <vector>
+#include <istream>
+#include <cstdint>
+
+#include "maze_render.hpp"
+
+#ifndef MAZE_BATCH_INCLUDE_GUARD
+#define MAZE_BATCH_INCLUDE_GUARD
+
+namespace maze {
+	struct job {
+		std::string algo;
+		int width, height;
+		uint_fast64_t seed;
+	};
+
+	std::vector<maze::job> readManifest(std::istream &in);
+	void runBatch(const std::vector<maze::job> &jobs, maze::sink out, const std::string &pattern, const std::string &format, const std::string &wall, const std::string &blank, const maze::image_style &image);
+}
+
+#endif
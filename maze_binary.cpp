@@ -0,0 +1,137 @@
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "maze_binary.hpp"
+
+namespace {
+	const char magic[8] = {'M', 'A', 'Z', 'E', 'B', 'I', 'N', '\0'};
+	const uint32_t version = 1, byte_order = 0x01020304;
+
+	struct header {
+		char magic[8];
+		uint32_t version, byte_order;
+		uint32_t width, height;
+		uint64_t seed;
+		char algo[32];
+	};
+	static_assert(sizeof(header) == 64, "maze file header should take 64 bytes");
+
+	uint64_t horizontalWords(uint64_t w, uint64_t h) {
+		return (w + 63)/64*(h + 1);
+	}
+	uint64_t verticalWords(uint64_t w, uint64_t h) {
+		return (w + 64)/64*h;
+	}
+}
+
+namespace maze {
+	void writeHeader(maze::sink out, uint32_t w, uint32_t h, const std::string &algo, uint64_t seed) {
+		header head;
+		std::memset(&head, 0, sizeof(head));
+		std::memcpy(head.magic, magic, sizeof(magic));
+		head.version = version;
+		head.byte_order = byte_order;
+		head.width = w;
+		head.height = h;
+		head.seed = seed;
+		std::strncpy(head.algo, algo.c_str(), sizeof(head.algo) - 1);
+		out.write(reinterpret_cast<const char *>(&head), sizeof(head));
+	}
+	void writeBinary(maze::sink out, const maze::structure &maze, const std::string &algo, uint64_t seed) {
+		const int w = maze.getWidth(), h = maze.getHeight();
+		maze::writeHeader(out, w, h, algo, seed);
+		out.write(reinterpret_cast<const char *>(maze.horizontal().row(0)), 8*horizontalWords(w, h));
+		out.write(reinterpret_cast<const char *>(maze.vertical().row(0)), 8*verticalWords(w, h));
+	}
+
+	mapped_structure::mapped_structure(const std::string &path):
+		base(nullptr), size(0),
+		view(0, 0),
+		seed(0) {
+			const char *bytes;
+#ifndef _WIN32
+			const int fd = open(path.c_str(), O_RDONLY);
+			if(fd < 0)
+				throw "couldn't open " + path;
+			struct stat info;
+			if(fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && std::size_t(info.st_size) >= sizeof(header)) {
+				size = info.st_size;
+				base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+				if(base == MAP_FAILED)
+					base = nullptr;
+			}
+			close(fd);
+#endif
+			// pipes and the like can't be mapped, so they are read into memory
+			if(!base) {
+				std::ifstream file(path, std::ios::binary);
+				if(!file.is_open())
+					throw "couldn't open " + path;
+				std::string data;
+				try {
+					data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+				} catch(const std::exception &) {
+					throw "couldn't read " + path;
+				}
+				size = data.size();
+				copy.resize((size + 7)/8);
+				std::memcpy(copy.data(), data.data(), size);
+			}
+			bytes = base ? static_cast<const char *>(base) : reinterpret_cast<const char *>(copy.data());
+
+			// a bad file mustn't leave its mapping behind
+			try {
+				header head;
+				if(size < sizeof(header))
+					throw path + " is not a maze file";
+				std::memcpy(&head, bytes, sizeof(head));
+				if(std::memcmp(head.magic, magic, sizeof(magic)))
+					throw path + " is not a maze file";
+				if(head.version != version)
+					throw path + " has unsupported version " + std::to_string(head.version);
+				if(head.byte_order != byte_order)
+					throw path + " was written on a machine with a different byte order";
+				if(head.width < 1 || head.height < 1)
+					throw path + " has an out of range maze size";
+				// tiled mode writes larger mazes than fit in a structure
+				if(head.width > UINT16_MAX || head.height > UINT16_MAX)
+					throw path + " is larger than " + std::to_string(UINT16_MAX) + " cells a side, which is as large as -i reads";
+				const uint64_t hor = horizontalWords(head.width, head.height), vert = verticalWords(head.width, head.height);
+				if(size < sizeof(header) + 8*(hor + vert))
+					throw path + " is truncated";
+
+				uint64_t *planes = reinterpret_cast<uint64_t *>(const_cast<char *>(bytes) + sizeof(header));
+				view = maze::structure(head.width, head.height, planes, planes + hor);
+				algo.assign(head.algo, strnlen(head.algo, sizeof(head.algo)));
+				seed = head.seed;
+			} catch(const std::string &) {
+#ifndef _WIN32
+				if(base)
+					munmap(base, size);
+#endif
+				throw;
+			}
+		}
+	mapped_structure::~mapped_structure() {
+#ifndef _WIN32
+		if(base)
+			munmap(base, size);
+#endif
+	}
+	maze::structure &mapped_structure::get() {
+		return view;
+	}
+	const std::string &mapped_structure::algorithm() const {
+		return algo;
+	}
+	uint64_t mapped_structure::getSeed() const {
+		return seed;
+	}
+}
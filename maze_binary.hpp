@@ -0,0 +1,42 @@
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include "maze_algorithms.hpp"
+#include "maze_render.hpp"
+
+#ifndef MAZE_BINARY_INCLUDE_GUARD
+#define MAZE_BINARY_INCLUDE_GUARD
+
+namespace maze {
+	class mapped_structure;
+
+	// a 64-byte header (magic, version, byte order, width, height, seed and
+	// algorithm name) followed by the hor and then the vert plane exactly as
+	// bitplane keeps them: rows of 64-bit words, padding bits zero
+	void writeBinary(maze::sink out, const maze::structure &maze, const std::string &algo, uint64_t seed);
+	// just the header, for writers that fill in the planes themselves
+	void writeHeader(maze::sink out, uint32_t w, uint32_t h, const std::string &algo, uint64_t seed);
+
+	// a maze file mapped into memory; the structure reads its walls straight
+	// from the mapping, and changes made through it stay private to the process
+	class mapped_structure {
+		void *base;
+		std::size_t size;
+		std::vector<uint64_t> copy;
+		maze::structure view;
+		std::string algo;
+		uint64_t seed;
+	public:
+		mapped_structure(const std::string &path);
+		~mapped_structure();
+		mapped_structure(const mapped_structure &) = delete;
+		mapped_structure &operator=(const mapped_structure &) = delete;
+		maze::structure &get();
+		const std::string &algorithm() const;
+		uint64_t getSeed() const;
+	};
+}
+
+#endif
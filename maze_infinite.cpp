@@ -0,0 +1,164 @@
+#include <algorithm>
+#include <iterator>
+
+#include "maze_infinite.hpp"
+#include "maze_random.hpp"
+
+namespace {
+	int64_t floorDiv(int64_t a, int64_t b) {
+		return a/b - (a % b < 0);
+	}
+	// copies n bits from bit from of src onto bit to of dest, whose bits there
+	// are clear, up to 64 at a time
+	void copyBits(uint64_t *dest, int to, const uint64_t *src, int from, int n) {
+		while(n > 0) {
+			const int m = std::min(n, 64), s = from % 64, d = to % 64;
+			uint64_t bits = src[from/64] >> s;
+			if(s && s + m > 64)
+				bits |= src[from/64 + 1] << (64 - s);
+			if(m < 64)
+				bits &= (uint64_t(1) << m) - 1;
+			dest[to/64] |= bits << d;
+			if(d && d + m > 64)
+				dest[to/64 + 1] |= bits >> (64 - d);
+			from += m;
+			to += m;
+			n -= m;
+		}
+	}
+}
+
+namespace maze {
+	std::size_t infinite_maze::chunk_hash::operator()(const std::pair<int64_t, int64_t> &key) const {
+		return (uint64_t(key.first)*0x9E3779B97F4A7C15) ^ uint64_t(key.second);
+	}
+
+	infinite_maze::infinite_maze(const std::string &algo_, uint64_t seed_, int size_, std::size_t capacity_, bool loops_):
+		algo(algo_), seed(seed_), size(size_), capacity(std::max<std::size_t>(1, capacity_)), loops(loops_),
+		last(nullptr),
+		hitCount(0), missCount(0) {
+			if(!maze::algo.count(algo))
+				throw "unknown algorithm " + algo;
+			if(size < 1 || size > UINT16_MAX)
+				throw "chunk size is out of its allowed range; try 1 to " + std::to_string(UINT16_MAX);
+			index.reserve(capacity);
+		}
+
+	// Philox is a pure function of its key and counter, so this neither needs
+	// nor touches the thread's engine; salt 0 keys the chunk's generator,
+	// 1 picks its link and the spot on its left wall, 2 the one on its top wall.
+	// The salt is hashed into the key, not added to it, so no two seeds share
+	// a key under different salts
+	uint64_t infinite_maze::mix(int64_t cx, int64_t cy, int salt) const {
+		uint32_t out[4];
+		maze::philox::block(maze::hash(seed, salt), cx, cy, out);
+		return uint64_t(out[1]) << 32 | out[0];
+	}
+	bool infinite_maze::linksLeft(int64_t cx, int64_t cy) const {
+		return loops || mix(cx, cy, 1) & 1;
+	}
+	bool infinite_maze::linksUp(int64_t cx, int64_t cy) const {
+		return loops || !(mix(cx, cy, 1) & 1);
+	}
+	void infinite_maze::generate(chunk &c) {
+		const maze::philox saved = maze::random_engine;
+		maze::randinit(mix(c.cx, c.cy, 0));
+		maze::algo[algo](ws, size, size);
+		maze::random_engine = saved;
+		c.walls = ws.result;
+
+		// the chunk's own links, and those of its right and lower neighbors
+		// that lead into it
+		if(linksLeft(c.cx, c.cy))
+			c.walls.vertical().set(0, (mix(c.cx, c.cy, 1) >> 32) % size, false);
+		if(linksUp(c.cx, c.cy))
+			c.walls.horizontal().set(mix(c.cx, c.cy, 2) % size, 0, false);
+		if(linksLeft(c.cx + 1, c.cy))
+			c.walls.vertical().set(size, (mix(c.cx + 1, c.cy, 1) >> 32) % size, false);
+		if(linksUp(c.cx, c.cy + 1))
+			c.walls.horizontal().set(mix(c.cx, c.cy + 1, 2) % size, size, false);
+	}
+	// the most recently used chunk is always at the front, so asking for it
+	// again skips the map and the list
+	const maze::structure &infinite_maze::fetch(int64_t cx, int64_t cy) {
+		if(last && last->cx == cx && last->cy == cy) {
+			hitCount++;
+			return last->walls;
+		}
+		const auto found = index.find({cx, cy});
+		if(found != index.end()) {
+			hitCount++;
+			chunks.splice(chunks.begin(), chunks, found->second);
+			last = &chunks.front();
+			return last->walls;
+		}
+
+		missCount++;
+		if(chunks.size() < capacity)
+			chunks.push_front({cx, cy, maze::structure(0, 0)});
+		else {
+			// the oldest chunk makes way, and its memory is reused
+			const auto oldest = std::prev(chunks.end());
+			index.erase({oldest->cx, oldest->cy});
+			chunks.splice(chunks.begin(), chunks, oldest);
+		}
+		chunk &c = chunks.front();
+		c.cx = cx;
+		c.cy = cy;
+		generate(c);
+		index[{cx, cy}] = chunks.begin();
+		last = &c;
+		return c.walls;
+	}
+
+	int infinite_maze::walls(int64_t x, int64_t y) {
+		const int64_t cx = floorDiv(x, size), cy = floorDiv(y, size);
+		const int lx = x - cx*size, ly = y - cy*size;
+		const maze::structure &c = fetch(cx, cy);
+		return
+			c.vertical().get(lx, ly)       << 3 |
+			c.vertical().get(lx + 1, ly)   << 2 |
+			c.horizontal().get(lx, ly)     << 1 |
+			c.horizontal().get(lx, ly + 1);
+	}
+	// row y of a wall plane from x on, n walls long, a chunk at a time; a
+	// wall belongs to the chunk of the cell right or below it
+	template<class P> void infinite_maze::gather(uint64_t *dest, int64_t x, int64_t y, int n, P plane) {
+		const int64_t cy = floorDiv(y, size);
+		const int ly = y - cy*size;
+		for(int done = 0; done < n; ) {
+			const int64_t cx = floorDiv(x + done, size);
+			const int lx = x + done - cx*size, take = std::min(n - done, size - lx);
+			copyBits(dest, done, plane(fetch(cx, cy)).row(ly), lx, take);
+			done += take;
+		}
+	}
+	// reset closes the edges, which the chunks may have open, so every row is
+	// cleared before its walls are copied in. The walls on the right and bottom
+	// edges are at x + w and y + h, so those have to fit in an int64_t
+	void infinite_maze::region(maze::structure &out, int64_t x, int64_t y, int w, int h) {
+		if(x > INT64_MAX - w || y > INT64_MAX - h)
+			throw "the window runs past the end of the maze; x + width and y + height go up to " + std::to_string(INT64_MAX);
+		out.reset(w, h, false);
+		maze::bitplane &hor = out.horizontal(), &vert = out.vertical();
+		for(int i = 0; i <= h; i++) {
+			std::fill(hor.row(i), hor.row(i) + hor.words(), 0);
+			if(i < h)
+				std::fill(vert.row(i), vert.row(i) + vert.words(), 0);
+			gather(hor.row(i), x, y + i, w, [](const maze::structure &c) -> const maze::bitplane & {
+				return c.horizontal();
+			});
+			if(i < h)
+				gather(vert.row(i), x, y + i, w + 1, [](const maze::structure &c) -> const maze::bitplane & {
+					return c.vertical();
+				});
+		}
+	}
+
+	uint64_t infinite_maze::hits() const {
+		return hitCount;
+	}
+	uint64_t infinite_maze::misses() const {
+		return missCount;
+	}
+}
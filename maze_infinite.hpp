@@ -0,0 +1,64 @@
+#include <string>
+#include <list>
+#include <unordered_map>
+#include <utility>
+#include <cstdint>
+
+#include "maze_algorithms.hpp"
+
+#ifndef MAZE_INFINITE_INCLUDE_GUARD
+#define MAZE_INFINITE_INCLUDE_GUARD
+
+namespace maze {
+	class infinite_maze;
+
+	// an endless maze over all 64-bit cell coordinates, generated lazily in
+	// size x size chunks. Chunk (cx, cy) is a maze from algo seeded by the
+	// seed and its coordinates, and opens to its left or upper neighbor, as a
+	// hash of the same picks, through one hashed spot on the shared wall;
+	// paths of these links always lead up or left and join up with each
+	// other, so the whole maze is a tree, that is perfect. With loops, every
+	// chunk opens to all four neighbors instead, which keeps neighboring
+	// chunks close at the cost of cycles between chunks.
+	// The last capacity chunks are kept, least recently used ones making way
+	// for new ones. Not thread-safe; give each thread its own
+	class infinite_maze {
+		struct chunk {
+			int64_t cx, cy;
+			maze::structure walls;
+		};
+		struct chunk_hash {
+			std::size_t operator()(const std::pair<int64_t, int64_t> &key) const;
+		};
+
+		std::string algo;
+		uint64_t seed;
+		int size;
+		std::size_t capacity;
+		bool loops;
+		maze::workspace ws;
+		// most recently used first
+		std::list<chunk> chunks;
+		std::unordered_map<std::pair<int64_t, int64_t>, std::list<chunk>::iterator, chunk_hash> index;
+		const chunk *last;
+		uint64_t hitCount, missCount;
+
+		uint64_t mix(int64_t cx, int64_t cy, int salt) const;
+		bool linksLeft(int64_t cx, int64_t cy) const;
+		bool linksUp(int64_t cx, int64_t cy) const;
+		void generate(chunk &c);
+		const maze::structure &fetch(int64_t cx, int64_t cy);
+		template<class P> void gather(uint64_t *dest, int64_t x, int64_t y, int n, P plane);
+	public:
+		infinite_maze(const std::string &algo_, uint64_t seed_, int size_ = 64, std::size_t capacity_ = 1024, bool loops_ = false);
+		// bit 3..0: whether (x, y) has a wall on its left/right/top/bottom
+		int walls(int64_t x, int64_t y);
+		// the w x h cells from (x, y) as a maze of their own, walls on the
+		// edges included; out is reset, reusing its memory
+		void region(maze::structure &out, int64_t x, int64_t y, int w, int h);
+		uint64_t hits() const;
+		uint64_t misses() const;
+	};
+}
+
+#endif
@@ -0,0 +1,29 @@
+#include <new>
+#include <atomic>
+#include <cstdlib>
+
+#include "maze_memory.hpp"
+
+namespace {
+	std::atomic<uint64_t> allocations(0);
+}
+
+// the array and nothrow forms of new and delete forward to these
+void *operator new(std::size_t size) {
+	allocations.fetch_add(1, std::memory_order_relaxed);
+	if(void *p = std::malloc(size ? size : 1))
+		return p;
+	throw std::bad_alloc();
+}
+void operator delete(void *p) noexcept {
+	std::free(p);
+}
+void operator delete(void *p, std::size_t) noexcept {
+	std::free(p);
+}
+
+namespace maze {
+	uint64_t allocationCount() {
+		return allocations.load(std::memory_order_relaxed);
+	}
+}
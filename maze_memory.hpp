@@ -0,0 +1,11 @@
+#include <cstdint>
+
+#ifndef MAZE_MEMORY_INCLUDE_GUARD
+#define MAZE_MEMORY_INCLUDE_GUARD
+
+namespace maze {
+	// heap allocations made through operator new by every thread since startup
+	uint64_t allocationCount();
+}
+
+#endif
@@ -0,0 +1,144 @@
+#include <memory>
+#include <algorithm>
+
+#include "maze_parallel.hpp"
+#include "maze_random.hpp"
+
+namespace {
+	int concurrency = 1;
+	std::unique_ptr<maze::thread_pool> shared;
+	// set while a thread runs pool tasks; nested parallel code then runs inline
+	thread_local bool busy = false;
+}
+
+namespace maze {
+	thread_pool::thread_pool(int threads):
+		job(nullptr),
+		next(0), count(0), running(0),
+		generation(0),
+		stopping(false) {
+			for(int i = 1; i < threads; i++)
+				workers.emplace_back([this]() {
+					unsigned long long seen = 0;
+					std::unique_lock<std::mutex> held(lock);
+					while(true) {
+						wake.wait(held, [&]() {
+							return stopping || generation != seen;
+						});
+						if(stopping)
+							return;
+						seen = generation;
+						work(held);
+					}
+				});
+		}
+	thread_pool::~thread_pool() {
+		{
+			std::lock_guard<std::mutex> held(lock);
+			stopping = true;
+		}
+		wake.notify_all();
+		for(std::thread &i: workers)
+			i.join();
+	}
+	int thread_pool::size() const {
+		return workers.size() + 1;
+	}
+	// takes tasks until the batch runs dry; called with the lock held
+	void thread_pool::work(std::unique_lock<std::mutex> &held) {
+		const maze::philox engine = maze::random_engine;
+		const bool nested = busy;
+		running++;
+		maze::random_engine.seed(key);
+		busy = true;
+		while(next < count) {
+			const int task = next++;
+			held.unlock();
+			(*job)(task);
+			held.lock();
+		}
+		busy = nested;
+		maze::random_engine = engine;
+		if(!--running)
+			done.notify_all();
+	}
+	void thread_pool::run(int tasks, const std::function<void(int)> &fn) {
+		std::unique_lock<std::mutex> held(lock);
+		job = &fn;
+		key = maze::random_engine.getKey();
+		next = 0;
+		count = tasks;
+		generation++;
+		wake.notify_all();
+		work(held);
+		done.wait(held, [this]() {
+			return !running && next == count;
+		});
+		job = nullptr;
+	}
+
+	task_pool::task_pool():
+		pending(0) {
+			for(int i = 0; i < maze::getConcurrency(); i++)
+				queues.emplace_back(new queue);
+		}
+	// worker is the index of the calling thread, as passed to the task
+	void task_pool::spawn(int worker, task t) {
+		pending++;
+		std::lock_guard<std::mutex> held(queues[worker]->lock);
+		queues[worker]->tasks.push_back(std::move(t));
+	}
+	bool task_pool::take(int worker, task &t) {
+		for(std::size_t i = 0; i < queues.size(); i++) {
+			queue &q = *queues[(worker + i) % queues.size()];
+			std::lock_guard<std::mutex> held(q.lock);
+			if(q.tasks.empty())
+				continue;
+			if(i) {
+				t = std::move(q.tasks.front());
+				q.tasks.pop_front();
+			} else {
+				t = std::move(q.tasks.back());
+				q.tasks.pop_back();
+			}
+			return true;
+		}
+		return false;
+	}
+	void task_pool::run(task root) {
+		const std::function<void(int)> drain = [this](int worker) {
+			task t;
+			while(pending.load()) {
+				if(!take(worker, t)) {
+					std::this_thread::yield();
+					continue;
+				}
+				t(*this, worker);
+				t = nullptr;
+				pending--;
+			}
+		};
+		spawn(0, std::move(root));
+		if(queues.size() == 1)
+			drain(0);
+		else
+			maze::pool().run(queues.size(), drain);
+	}
+
+	void setConcurrency(int threads) {
+		if(threads < 1)
+			threads = std::max(1u, std::thread::hardware_concurrency());
+		if(threads != concurrency)
+			shared.reset();
+		concurrency = threads;
+	}
+	// the number of threads the caller may use: 1 inside a pool task
+	int getConcurrency() {
+		return busy ? 1 : concurrency;
+	}
+	maze::thread_pool &pool() {
+		if(!shared)
+			shared.reset(new maze::thread_pool(concurrency));
+		return *shared;
+	}
+}
@@ -0,0 +1,80 @@
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <deque>
+#include <atomic>
+#include <memory>
+#include <algorithm>
+
+#ifndef MAZE_PARALLEL_INCLUDE_GUARD
+#define MAZE_PARALLEL_INCLUDE_GUARD
+
+namespace maze {
+	class thread_pool;
+	class task_pool;
+
+	// runs batches of independent tasks on a fixed set of worker threads;
+	// the calling thread takes part too, so a pool of size 1 has no workers
+	class thread_pool {
+		std::vector<std::thread> workers;
+		std::mutex lock;
+		std::condition_variable wake, done;
+		const std::function<void(int)> *job;
+		uint64_t key;
+		int next, count, running;
+		unsigned long long generation;
+		bool stopping;
+		void work(std::unique_lock<std::mutex> &held);
+	public:
+		thread_pool(int threads);
+		~thread_pool();
+		int size() const;
+		void run(int tasks, const std::function<void(int)> &fn);
+	};
+
+	// work-stealing scheduler for trees of tasks on the shared thread pool:
+	// each thread runs its newest task first and, when out of work, steals the
+	// oldest task of another thread, which tends to be the largest
+	class task_pool {
+	public:
+		using task = std::function<void(maze::task_pool &, int)>;
+	private:
+		struct queue {
+			std::mutex lock;
+			std::deque<task> tasks;
+		};
+		std::vector<std::unique_ptr<queue> > queues;
+		std::atomic<long long> pending;
+		bool take(int worker, task &t);
+	public:
+		task_pool();
+		void spawn(int worker, task t);
+		void run(task root);
+	};
+
+	void setConcurrency(int threads);
+	int getConcurrency();
+	maze::thread_pool &pool();
+
+	// splits [begin, end) into a few contiguous bands per thread and hands each
+	// to band(from, to); runs inline, without wrapping band, when there is
+	// only one thread
+	template<class F> void parallel_for(int begin, int end, const F &band) {
+		if(begin >= end)
+			return;
+		const int threads = maze::getConcurrency();
+		if(threads == 1) {
+			band(begin, end);
+			return;
+		}
+		const int bands = std::min(end - begin, 4*threads);
+		const long long size = end - begin;
+		maze::pool().run(bands, [&](int i) {
+			band(begin + size*i/bands, begin + size*(i + 1)/bands);
+		});
+	}
+}
+
+#endif
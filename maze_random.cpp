@@ -0,0 +1,146 @@
+#include "maze_random.hpp"
+#include "maze_stats.hpp"
+
+namespace {
+	const uint32_t
+		multiplier[2] = {0xD2511F53, 0xCD9E8D57},
+		weyl[2] = {0x9E3779B9, 0xBB67AE85};
+
+	// for each of the 16 direction masks taken by randbit: how many bits
+	// are set, and which bit is the r-th set one
+	struct direction_table {
+		int count[16], pick[16][4];
+		direction_table() {
+			for(int i = 0; i < 16; i++) {
+				count[i] = 0;
+				for(int j = 0; j < 4; j++)
+					if(i & 1 << j)
+						pick[i][count[i]++] = j;
+			}
+		}
+	} const directions;
+}
+
+namespace maze {
+	thread_local maze::philox random_engine;
+
+	philox::philox(uint64_t key_, uint64_t id_) {
+		seed(key_, id_);
+	}
+	void philox::seed(uint64_t key_, uint64_t id_) {
+		key = key_;
+		id = id_;
+		counter = 0;
+		used = 4;
+		pooled = 0;
+	}
+	uint64_t philox::getKey() const {
+		return key;
+	}
+	maze::philox philox::split(uint64_t id_) const {
+		return maze::philox(key, id_);
+	}
+	uint32_t philox::next32() {
+		if(used == 4) {
+			MAZE_COUNT(rng_blocks, 1);
+			block(key, id, counter++, buffer);
+			used = 0;
+		}
+		return buffer[used++];
+	}
+	philox::result_type philox::operator()() {
+		const uint64_t low = next32();
+		return uint64_t(next32()) << 32 | low;
+	}
+	// n <= 32 bits, served from a pool refilled 64 bits at a time
+	uint32_t philox::bits(int n) {
+		if(pooled < n) {
+			pool = (*this)();
+			pooled = 64;
+		}
+		const uint32_t result = pool & ((uint64_t(1) << n) - 1);
+		pool >>= n;
+		pooled -= n;
+		return result;
+	}
+	// uniform in [0, n) by Lemire's multiply-and-reject, without a division
+	// in the common case; powers of two come straight from the bit pool
+	uint32_t philox::bounded(uint32_t n) {
+		if(!(n & (n - 1)))
+			return bits(__builtin_ctz(n));
+		uint64_t m = uint64_t(next32())*n;
+		if(uint32_t(m) < n) {
+			const uint32_t threshold = -n % n;
+			while(uint32_t(m) < threshold)
+				m = uint64_t(next32())*n;
+		}
+		return m >> 32;
+	}
+	// the same over 64 bits, for ranges past 32 bits
+	uint64_t philox::bounded64(uint64_t n) {
+		unsigned __int128 m = (unsigned __int128)(*this)()*n;
+		if(uint64_t(m) < n) {
+			const uint64_t threshold = -n % n;
+			while(uint64_t(m) < threshold)
+				m = (unsigned __int128)(*this)()*n;
+		}
+		return m >> 64;
+	}
+	void philox::block(uint64_t key, uint64_t id, uint64_t counter, uint32_t out[4]) {
+		uint32_t
+			c[4] = {uint32_t(counter), uint32_t(counter >> 32), uint32_t(id), uint32_t(id >> 32)},
+			k[2] = {uint32_t(key), uint32_t(key >> 32)};
+		for(int i = 0; i < 10; i++) {
+			const uint64_t
+				p0 = uint64_t(multiplier[0])*c[0],
+				p1 = uint64_t(multiplier[1])*c[2];
+			const uint32_t t[4] = {
+				uint32_t(p1 >> 32) ^ c[1] ^ k[0], uint32_t(p1),
+				uint32_t(p0 >> 32) ^ c[3] ^ k[1], uint32_t(p0)
+			};
+			for(int j = 0; j < 4; j++)
+				c[j] = t[j];
+			k[0] += weyl[0];
+			k[1] += weyl[1];
+		}
+		for(int i = 0; i < 4; i++)
+			out[i] = c[i];
+	}
+
+	void randinit(uint_fast64_t seed) {
+		random_engine.seed(seed);
+	}
+	maze::philox stream(uint64_t id) {
+		return maze::random_engine.split(id);
+	}
+	// a cheap keyed mix of n for per-item random values, such as edge priorities
+	uint64_t hash(uint64_t key, uint64_t n) {
+		uint64_t z = key ^ (n + 1)*0x9E3779B97F4A7C15;
+		z = (z ^ z >> 30)*0xBF58476D1CE4E5B9;
+		z = (z ^ z >> 27)*0x94D049BB133111EB;
+		z ^= z >> 31;
+		z = ((z + 0x9E3779B97F4A7C15) ^ (z >> 29))*0xBF58476D1CE4E5B9;
+		return z ^ z >> 32;
+	}
+	int rand(int max) {
+		return maze::rand(maze::random_engine, max);
+	}
+	int rand(maze::philox &engine, int max) {
+		MAZE_COUNT(rng_draws, 1);
+		return engine.bounded(max);
+	}
+	uint64_t rand64(uint64_t max) {
+		MAZE_COUNT(rng_draws, 1);
+		return maze::random_engine.bounded64(max);
+	}
+	int randbit(int bits) {
+		return maze::randbit(maze::random_engine, bits);
+	}
+	int randbit(maze::philox &engine, int bits) {
+		MAZE_COUNT(rng_draws, 1);
+		const int n = directions.count[bits];
+		if(!n)
+			return 0;
+		return directions.pick[bits][engine.bounded(n)];
+	}
+}
@@ -0,0 +1,60 @@
+#include <cstdint>
+#include <chrono>
+#include <limits>
+
+#ifndef MAZE_RANDOM_INCLUDE_GUARD
+#define MAZE_RANDOM_INCLUDE_GUARD
+
+namespace maze {
+	class philox;
+
+	// Philox4x32-10 counter-based generator: every output is a pure function of
+	// (key, stream, position), so independent streams can be split off a seed
+	// and evaluated on any thread in any order with identical results
+	class philox {
+		uint64_t key, id, counter;
+		uint32_t buffer[4];
+		int used;
+		uint64_t pool;
+		int pooled;
+		uint32_t next32();
+	public:
+		using result_type = uint64_t;
+		static constexpr uint64_t sequential = std::numeric_limits<uint64_t>::max();
+
+		philox(uint64_t key_ = 0, uint64_t id_ = sequential);
+		void seed(uint64_t key_, uint64_t id_ = sequential);
+		uint64_t getKey() const;
+		maze::philox split(uint64_t id_) const;
+		result_type operator()();
+		uint32_t bits(int n);
+		uint32_t bounded(uint32_t n);
+		uint64_t bounded64(uint64_t n);
+		static constexpr result_type min() {
+			return 0;
+		}
+		static constexpr result_type max() {
+			return std::numeric_limits<result_type>::max();
+		}
+		static void block(uint64_t key, uint64_t id, uint64_t counter, uint32_t out[4]);
+	};
+
+	// each thread has its own engine; thread pools hand their caller's key on
+	// to the workers, so split streams agree across threads
+	extern thread_local maze::philox random_engine;
+
+	void randinit(uint_fast64_t seed = std::chrono::duration_cast<std::chrono::microseconds>(
+		std::chrono::time_point_cast<std::chrono::microseconds>(
+			std::chrono::steady_clock::now()
+		).time_since_epoch()
+	).count());
+	maze::philox stream(uint64_t id);
+	uint64_t hash(uint64_t key, uint64_t n);
+	int rand(int max);
+	int rand(maze::philox &engine, int max);
+	uint64_t rand64(uint64_t max);
+	int randbit(int bits);
+	int randbit(maze::philox &engine, int bits);
+}
+
+#endif
@@ -0,0 +1,324 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "maze_render.hpp"
+
+namespace {
+	long write_fd(int fd, const char *data, std::size_t size) {
+#ifdef _WIN32
+		return _write(fd, data, size);
+#else
+		return ::write(fd, data, size);
+#endif
+	}
+	// PGM walls are black and passages white
+	unsigned char *fillGray(unsigned char *dest, bool on, int n) {
+		const unsigned char value = on ? 0 : 255;
+		for(int i = 0; i < n; i++)
+			dest[i] = value;
+		return dest + n;
+	}
+}
+
+namespace maze {
+	sink::sink(std::ostream &out):
+		stream(&out), text(nullptr), fd(-1) {}
+	sink::sink(std::string &out):
+		stream(nullptr), text(&out), fd(-1) {}
+	sink::sink(int fd_):
+		stream(nullptr), text(nullptr), fd(fd_) {}
+	void sink::write(const char *data, std::size_t size) {
+		if(text) {
+			text->append(data, size);
+			return;
+		}
+		if(stream) {
+			if(!stream->write(data, size))
+				throw std::string("couldn't write output");
+			return;
+		}
+		while(size) {
+			long written = write_fd(fd, data, size);
+			if(written < 0) {
+				if(errno == EINTR)
+					continue;
+				throw std::string("couldn't write output");
+			}
+			data += written;
+			size -= written;
+		}
+	}
+
+	text_renderer::text_renderer(maze::sink out_, int w, const std::string &wall_, const std::string &blank_, const std::string &path_):
+		out(out_), width(w), tile(0),
+		wall(wall_), blank(blank_), path(path_),
+		buffer(new char[chunk_size + (2*std::size_t(w) + 1)*std::max({wall.size(), blank.size(), path.size()}) + 1]),
+		used(0) {
+			const std::size_t size = wall.size();
+			if(size && size == blank.size() && 16 % size == 0
+				&& wall.find_first_not_of(wall[0]) == std::string::npos
+				&& blank.find_first_not_of(blank[0]) == std::string::npos)
+				tile = size;
+			if(!tile)
+				return;
+
+			for(int v = 0; v < tile; v++)
+				for(int j = 0; j < 16; j++) {
+					const int t = (16*v + j)/tile;
+					test[v][j] = t % 2 ? 0 : 1 << t/2;
+					set[0][v][j] = wall[0];
+					set[1][v][j] = t % 2 ? blank[0] : wall[0];
+					clear[0][v][j] = t % 2 ? wall[0] : blank[0];
+					clear[1][v][j] = blank[0];
+				}
+		}
+	void text_renderer::append(const std::string &str) {
+		std::memcpy(buffer.get() + used, str.data(), str.size());
+		used += str.size();
+	}
+	// writes every cell's tile and the tile after it, for the cells of a row
+	// in whole groups of 8; the tiles after the cells are wall in horizontal
+	// rows and blank in vertical ones
+	void text_renderer::expand(const uint64_t *walls, int kind) {
+		char *dest = buffer.get() + used;
+		for(int i = 0; i < width/8; i++) {
+			const int bits = walls[i/8] >> i % 8*8 & 0xFF;
+#ifdef __SSE2__
+			const __m128i group = _mm_set1_epi8(char(bits));
+			for(int v = 0; v < tile; v++) {
+				const __m128i
+					lanes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(test[v])),
+					on = _mm_cmpeq_epi8(_mm_and_si128(group, lanes), lanes);
+				_mm_storeu_si128(reinterpret_cast<__m128i *>(dest), _mm_or_si128(
+					_mm_and_si128(on, _mm_loadu_si128(reinterpret_cast<const __m128i *>(set[kind][v]))),
+					_mm_andnot_si128(on, _mm_loadu_si128(reinterpret_cast<const __m128i *>(clear[kind][v])))
+				));
+				dest += 16;
+			}
+#else
+			for(int v = 0; v < tile; v++)
+				for(int j = 0; j < 16; j++)
+					*dest++ = (bits & test[v][j]) == test[v][j] ? set[kind][v][j] : clear[kind][v][j];
+#endif
+		}
+		used = dest - buffer.get();
+	}
+	void text_renderer::horizontalTiles(const uint64_t *walls) {
+		std::memset(buffer.get() + used, wall[0], tile);
+		used += tile;
+		expand(walls, 0);
+		for(int i = width/8*8; i < width; i++) {
+			std::memset(buffer.get() + used, walls[i/64] >> i % 64 & 1 ? wall[0] : blank[0], tile);
+			std::memset(buffer.get() + used + tile, wall[0], tile);
+			used += 2*tile;
+		}
+	}
+	void text_renderer::verticalTiles(const uint64_t *walls) {
+		expand(walls, 1);
+		for(int i = width/8*8; i < width; i++) {
+			std::memset(buffer.get() + used, walls[i/64] >> i % 64 & 1 ? wall[0] : blank[0], tile);
+			std::memset(buffer.get() + used + tile, blank[0], tile);
+			used += 2*tile;
+		}
+		std::memset(buffer.get() + used, walls[width/64] >> width % 64 & 1 ? wall[0] : blank[0], tile);
+		used += tile;
+	}
+	// overwrites tile first + 2*i of the row starting at start with the path,
+	// for every set bit i; paths are thin, so this skips whole words at once
+	void text_renderer::drawPath(std::size_t start, const uint64_t *bits, int n, int first) {
+		for(int j = 0; j < (n + 63)/64; j++)
+			for(uint64_t word = bits[j]; word; word &= word - 1) {
+				const int i = 64*j + __builtin_ctzll(word);
+				std::memcpy(buffer.get() + start + std::size_t(first + 2*i)*tile, path.data(), tile);
+			}
+	}
+	void text_renderer::endRow() {
+		buffer[used++] = '\n';
+		if(used >= chunk_size)
+			flush();
+	}
+	void text_renderer::horizontal(const uint64_t *walls) {
+		if(tile)
+			horizontalTiles(walls);
+		else {
+			append(wall);
+			for(int i = 0; i < width; i++) {
+				append(walls[i/64] >> i % 64 & 1 ? wall : blank);
+				append(wall);
+			}
+		}
+		endRow();
+	}
+	void text_renderer::vertical(const uint64_t *walls) {
+		if(tile)
+			verticalTiles(walls);
+		else {
+			for(int i = 0; i < width; i++) {
+				append(walls[i/64] >> i % 64 & 1 ? wall : blank);
+				append(blank);
+			}
+			append(walls[width/64] >> width % 64 & 1 ? wall : blank);
+		}
+		endRow();
+	}
+	void text_renderer::horizontal(const uint64_t *walls, const uint64_t *passages) {
+		if(tile && path.size() == std::size_t(tile)) {
+			const std::size_t start = used;
+			horizontalTiles(walls);
+			drawPath(start, passages, width, 1);
+		} else {
+			append(wall);
+			for(int i = 0; i < width; i++) {
+				append(walls[i/64] >> i % 64 & 1 ? wall : passages[i/64] >> i % 64 & 1 ? path : blank);
+				append(wall);
+			}
+		}
+		endRow();
+	}
+	void text_renderer::vertical(const uint64_t *walls, const uint64_t *passages, const uint64_t *cells) {
+		if(tile && path.size() == std::size_t(tile)) {
+			const std::size_t start = used;
+			verticalTiles(walls);
+			drawPath(start, passages, width + 1, 0);
+			drawPath(start, cells, width, 1);
+		} else {
+			for(int i = 0; i <= width; i++) {
+				append(walls[i/64] >> i % 64 & 1 ? wall : passages[i/64] >> i % 64 & 1 ? path : blank);
+				if(i < width)
+					append(cells[i/64] >> i % 64 & 1 ? path : blank);
+			}
+		}
+		endRow();
+	}
+	void text_renderer::flush() {
+		out.write(buffer.get(), used);
+		used = 0;
+	}
+
+	image_renderer::image_renderer(maze::sink out_, int w, const maze::image_style &style_):
+		out(out_), width(w), style(style_), used(0) {
+			const std::size_t pixels = std::size_t(w)*style.cell + std::size_t(w + 1)*style.wall;
+			lineSize = style.gray ? pixels : (pixels + 7)/8;
+			line.reset(new char[lineSize]);
+			buffer.reset(new char[chunk_size + lineSize*std::max(style.cell, style.wall)]);
+			for(int i = 0; i < 256; i++) {
+				spread[0][i] = spread[1][i] = 0;
+				for(int j = 0; j < 8; j++) {
+					spread[0][i] |= (i >> j & 1) << (15 - 2*j) | 1 << (14 - 2*j);
+					spread[1][i] |= (i >> j & 1) << (15 - 2*j);
+				}
+			}
+		}
+	void image_renderer::header(uint64_t h) {
+		const std::string text =
+			(style.gray ? "P5\n" : "P4\n")
+			+ std::to_string(uint64_t(width)*style.cell + uint64_t(width + 1)*style.wall) + " "
+			+ std::to_string(h*style.cell + (h + 1)*style.wall) + "\n"
+			+ (style.gray ? "255\n" : "");
+		out.write(text.data(), text.size());
+	}
+	// lays out one pixel row of a wall row (kind 0) or a cell row (kind 1);
+	// PBM pixels are packed into bytes most significant bit first
+	void image_renderer::fill(const uint64_t *walls, int kind) {
+		if(style.gray) {
+			unsigned char *dest = reinterpret_cast<unsigned char *>(line.get());
+			if(kind == 0)
+				dest = fillGray(dest, true, style.wall);
+			if(style.cell == 1 && style.wall == 1) {
+				const unsigned char after = kind == 0 ? 0 : 255;
+				for(int i = 0; i < width; i++) {
+					dest[2*i] = walls[i/64] >> i % 64 & 1 ? 0 : 255;
+					dest[2*i + 1] = after;
+				}
+				if(kind == 1)
+					dest[2*width] = walls[width/64] >> width % 64 & 1 ? 0 : 255;
+				return;
+			}
+			for(int i = 0; i < width; i++) {
+				const bool on = walls[i/64] >> i % 64 & 1;
+				if(kind == 0) {
+					dest = fillGray(dest, on, style.cell);
+					dest = fillGray(dest, true, style.wall);
+				} else {
+					dest = fillGray(dest, on, style.wall);
+					dest = fillGray(dest, false, style.cell);
+				}
+			}
+			if(kind == 1)
+				fillGray(dest, walls[width/64] >> width % 64 & 1, style.wall);
+			return;
+		}
+
+		unsigned char *dest = reinterpret_cast<unsigned char *>(line.get());
+		uint64_t bits = 0;
+		int count = 0;
+		auto put = [&](uint64_t value, int n) {
+			bits = bits << n | value;
+			count += n;
+			while(count >= 8) {
+				count -= 8;
+				*dest++ = bits >> count;
+			}
+		};
+		auto tile = [&](bool on, int n) {
+			for(; n >= 32; n -= 32)
+				put(on ? 0xFFFFFFFF : 0, 32);
+			put(on ? (uint64_t(1) << n) - 1 : 0, n);
+		};
+		auto bit = [&](int i) {
+			return bool(walls[i/64] >> i % 64 & 1);
+		};
+
+		int i = 0;
+		if(kind == 0)
+			tile(true, style.wall);
+		if(style.cell == 1 && style.wall == 1)
+			for(; i < width/8*8; i += 8)
+				put(spread[kind][walls[i/64] >> i % 64 & 0xFF], 16);
+		for(; i < width; i++)
+			if(kind == 0) {
+				tile(bit(i), style.cell);
+				tile(true, style.wall);
+			} else {
+				tile(bit(i), style.wall);
+				tile(false, style.cell);
+			}
+		if(kind == 1)
+			tile(bit(width), style.wall);
+		if(count)
+			*dest = bits << (8 - count);
+	}
+	void image_renderer::emit(int times) {
+		for(int i = 0; i < times; i++) {
+			std::memcpy(buffer.get() + used, line.get(), lineSize);
+			used += lineSize;
+		}
+		if(used >= chunk_size)
+			flush();
+	}
+	void image_renderer::horizontal(const uint64_t *walls) {
+		fill(walls, 0);
+		emit(style.wall);
+	}
+	void image_renderer::vertical(const uint64_t *walls) {
+		fill(walls, 1);
+		emit(style.cell);
+	}
+	void image_renderer::flush() {
+		out.write(buffer.get(), used);
+		used = 0;
+	}
+	// bytes of output per maze row, wall pixels and cell pixels together
+	std::size_t image_renderer::rowSize() const {
+		return lineSize*(style.cell + style.wall);
+	}
+}
@@ -0,0 +1,96 @@
+#include <string>
+#include <ostream>
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+
+#ifndef MAZE_RENDER_INCLUDE_GUARD
+#define MAZE_RENDER_INCLUDE_GUARD
+
+namespace maze {
+	class sink;
+	class text_renderer;
+	struct image_style;
+	class image_renderer;
+
+	class sink {
+		std::ostream *stream;
+		std::string *text;
+		int fd;
+	public:
+		sink(std::ostream &out);
+		sink(std::string &out);
+		sink(int fd_);
+		void write(const char *data, std::size_t size);
+	};
+
+	// renders a maze one text row at a time, handing the output to a sink
+	// in chunks of about chunk_size bytes; memory use only depends on width.
+	// When wall and blank are the same byte repeated tile times, for a tile
+	// size that divides 16, rows are expanded from the wall bits 8 cells at a
+	// time instead of string by string
+	class text_renderer {
+		maze::sink out;
+		int width, tile;
+		std::string wall, blank, path;
+		std::unique_ptr<char[]> buffer;
+		std::size_t used;
+		// lane j of vector v in an 8-cell group: the cell bit it tests (0 for
+		// the tile after each cell), and its byte when that bit is set or clear
+		// in horizontal (0) and vertical (1) rows; a group takes tile vectors,
+		// up to 16
+		unsigned char test[16][16], set[2][16][16], clear[2][16][16];
+		void append(const std::string &str);
+		void expand(const uint64_t *walls, int kind);
+		void horizontalTiles(const uint64_t *walls);
+		void verticalTiles(const uint64_t *walls);
+		void drawPath(std::size_t start, const uint64_t *bits, int n, int first);
+		void endRow();
+	public:
+		static const std::size_t chunk_size = 1 << 20;
+
+		text_renderer(maze::sink out_, int w, const std::string &wall_, const std::string &blank_, const std::string &path_ = "");
+		void horizontal(const uint64_t *walls);
+		void vertical(const uint64_t *walls);
+		// rows with a path drawn in: bit i of passages is the open tile below
+		// or left of cell i, and bit i of cells the cell itself
+		void horizontal(const uint64_t *walls, const uint64_t *passages);
+		void vertical(const uint64_t *walls, const uint64_t *passages, const uint64_t *cells);
+		void flush();
+	};
+
+	// cells are cell pixels across and walls wall pixels thick; gray picks
+	// PGM over PBM
+	struct image_style {
+		bool gray;
+		int cell, wall;
+	};
+
+	// renders a maze as a binary PBM (P4, walls black) or PGM (P5, walls 0 and
+	// passages 255) image, building each pixel row once and repeating it for
+	// the thickness of its maze row; header() starts the image for a maze of
+	// height h, band renderers leave it out
+	class image_renderer {
+		maze::sink out;
+		int width;
+		maze::image_style style;
+		std::size_t lineSize, used;
+		std::unique_ptr<char[]> line, buffer;
+		// pixel pairs (cell bit, wall after it) for 8 cells at a time, with
+		// scale 1 PBM rows; wall rows (0) put a post after each cell
+		uint16_t spread[2][256];
+		void fill(const uint64_t *walls, int kind);
+		void emit(int times);
+	public:
+		static const std::size_t chunk_size = 1 << 20;
+
+		image_renderer(maze::sink out_, int w, const maze::image_style &style_);
+		void header(uint64_t h);
+		void horizontal(const uint64_t *walls);
+		void vertical(const uint64_t *walls);
+		void flush();
+		std::size_t rowSize() const;
+	};
+}
+
+#endif
@@ -0,0 +1,164 @@
+#include <vector>
+#include <limits>
+
+#include "maze_solve.hpp"
+
+namespace {
+	const uint64_t none = std::numeric_limits<uint64_t>::max();
+
+	// one breadth-first search: each reached cell keeps the direction back
+	// toward the origin in 2 bits, and the frontier holds one level at a time
+	// as y << 16 | x, which fits the largest maze
+	class search {
+		const maze::structure &maze;
+		int width, ox, oy;
+		std::vector<uint64_t> parent;
+		std::vector<uint32_t> frontier, next;
+	public:
+		maze::bitplane seen;
+
+		search(const maze::structure &maze_, int x, int y):
+			maze(maze_), width(maze.getWidth()), ox(x), oy(y),
+			parent((uint64_t(width)*maze.getHeight() + 31)/32),
+			frontier{uint32_t(y) << 16 | x},
+			seen(width, maze.getHeight(), false) {
+				seen.set(x, y, true);
+			}
+		bool done() const {
+			return frontier.empty();
+		}
+		std::size_t size() const {
+			return frontier.size();
+		}
+		// expands the whole frontier by one level; returns the first new cell
+		// that other has reached too, if any
+		uint64_t expand(const search *other) {
+			for(const uint32_t c: frontier) {
+				const int x = c & 0xFFFF, y = c >> 16, dirs = maze.openings(x, y);
+				for(int dir = 0; dir < 4; dir++) {
+					if(!(dirs & 1 << dir))
+						continue;
+					int nx = x, ny = y;
+					maze::step(nx, ny, dir);
+					if(seen.get(nx, ny))
+						continue;
+					const uint64_t n = uint64_t(ny)*width + nx;
+					seen.set(nx, ny, true);
+					parent[n/32] |= uint64_t(dir ^ 1) << n % 32*2;
+					next.push_back(uint32_t(ny) << 16 | nx);
+					if(other && other->seen.get(nx, ny)) {
+						next.clear();
+						return n;
+					}
+				}
+			}
+			std::swap(frontier, next);
+			next.clear();
+			return none;
+		}
+		// marks the cells from (x, y) back to the origin
+		void trace(int x, int y, maze::bitplane &route) const {
+			route.set(x, y, true);
+			while(x != ox || y != oy) {
+				const uint64_t c = uint64_t(y)*width + x;
+				maze::step(x, y, parent[c/32] >> c % 32*2 & 3);
+				route.set(x, y, true);
+			}
+		}
+	};
+
+	void check(const maze::structure &maze, int x, int y) {
+		if(x < 0 || x >= maze.getWidth() || y < 0 || y >= maze.getHeight())
+			throw std::string("the start and the goal should be inside the maze");
+	}
+}
+
+namespace maze {
+	maze::bitplane solveBFS(const maze::structure &maze, int sx, int sy, int gx, int gy) {
+		check(maze, sx, sy);
+		check(maze, gx, gy);
+		search from(maze, sx, sy);
+		while(!from.seen.get(gx, gy) && !from.done())
+			from.expand(nullptr);
+		if(!from.seen.get(gx, gy))
+			throw std::string("there is no path between the start and the goal");
+
+		maze::bitplane route(maze.getWidth(), maze.getHeight(), false);
+		from.trace(gx, gy, route);
+		return route;
+	}
+	maze::bitplane solveBidirectional(const maze::structure &maze, int sx, int sy, int gx, int gy) {
+		check(maze, sx, sy);
+		check(maze, gx, gy);
+		const int w = maze.getWidth(), h = maze.getHeight();
+		search from(maze, sx, sy), to(maze, gx, gy);
+		uint64_t meet = sx == gx && sy == gy ? uint64_t(sy)*w + sx : none;
+		while(meet == none) {
+			if(from.done() || to.done())
+				throw std::string("there is no path between the start and the goal");
+			if(from.size() <= to.size())
+				meet = from.expand(&to);
+			else
+				meet = to.expand(&from);
+		}
+
+		maze::bitplane route(w, h, false);
+		from.trace(meet % w, meet/w, route);
+		to.trace(meet % w, meet/w, route);
+		return route;
+	}
+	maze::bitplane solveDeadEnds(const maze::structure &maze, int sx, int sy, int gx, int gy) {
+		check(maze, sx, sy);
+		check(maze, gx, gy);
+		const int w = maze.getWidth(), h = maze.getHeight();
+		maze::bitplane route(w, h, true);
+		// bit 3..0: the open, unfilled neighbors of (x, y)
+		auto unfilled = [&](int x, int y) {
+			int open = 0;
+			const int dirs = maze.openings(x, y);
+			for(int dir = 0; dir < 4; dir++) {
+				int nx = x, ny = y;
+				maze::step(nx, ny, dir);
+				if(dirs & 1 << dir && route.get(nx, ny))
+					open |= 1 << dir;
+			}
+			return open;
+		};
+
+		// walks start from the cells with at most one opening, found 64 at a
+		// time from the wall words; whatever they expose further in gets
+		// filled by the walk that reaches it last
+		for(int i = 0; i < h; i++)
+			for(std::size_t j = 0; j < maze.horizontal().words(); j++) {
+				uint64_t ways[4];
+				const uint64_t cells = maze.openings(i, j, ways);
+				uint64_t odd = 0, several = 0;
+				for(const uint64_t way: ways) {
+					several |= odd & way;
+					odd ^= way;
+				}
+				for(uint64_t ends = cells & ~several; ends; ends &= ends - 1) {
+					int x = 64*j + __builtin_ctzll(ends), y = i;
+					while(route.get(x, y) && !(x == sx && y == sy) && !(x == gx && y == gy)) {
+						const int open = unfilled(x, y);
+						if(open & (open - 1))
+							break;
+						route.set(x, y, false);
+						if(!open)
+							break;
+						maze::step(x, y, __builtin_ctz(open));
+					}
+				}
+			}
+
+		if(!route.get(sx, sy) || !route.get(gx, gy) || (unfilled(sx, sy) == 0 && !(sx == gx && sy == gy)))
+			throw std::string("there is no path between the start and the goal");
+		return route;
+	}
+
+	std::map<std::string, maze::bitplane (*)(const maze::structure &, int, int, int, int)> solver{
+		{"bfs", solveBFS},
+		{"bidirectional", solveBidirectional},
+		{"dead-end-filling", solveDeadEnds}
+	};
+}
@@ -0,0 +1,27 @@
+#include <string>
+#include <map>
+
+#include "maze_algorithms.hpp"
+
+#ifndef MAZE_SOLVE_INCLUDE_GUARD
+#define MAZE_SOLVE_INCLUDE_GUARD
+
+namespace maze {
+	// every solver returns the cells on the path from (sx, sy) to (gx, gy) as a
+	// bitplane the size of the maze, and throws if there is no such path
+
+	// breadth-first search with a visited bitset and a 2-bit parent direction
+	// per cell, O(cells/4) bytes besides the frontier
+	maze::bitplane solveBFS(const maze::structure &maze, int sx, int sy, int gx, int gy);
+	// the same search run from both ends, a level of the smaller frontier at a
+	// time, until they meet; this is the shortest path in a perfect maze
+	maze::bitplane solveBidirectional(const maze::structure &maze, int sx, int sy, int gx, int gy);
+	// fills every dead end other than the start and the goal, following each
+	// corridor until it reaches a junction, in one pass and O(cells/8) bytes;
+	// in a perfect maze what is left unfilled is the path
+	maze::bitplane solveDeadEnds(const maze::structure &maze, int sx, int sy, int gx, int gy);
+
+	extern std::map<std::string, maze::bitplane (*)(const maze::structure &, int, int, int, int)> solver;
+}
+
+#endif
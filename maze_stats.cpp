@@ -0,0 +1,84 @@
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <sstream>
+
+#include "maze_stats.hpp"
+
+namespace {
+	const char *const counter_names[maze::stats::counters] = {
+		"rng_blocks", "rng_draws",
+		"union_find_finds", "union_find_path_steps", "union_find_joins",
+		"walk_steps", "loop_erasures",
+		"hunts", "hunt_words_scanned",
+		"peak_frontier", "peak_stack"
+	};
+	const char *const phase_names[maze::stats::phases] = {
+		"allocate", "generate", "solve", "analyze", "render"
+	};
+
+	// a block per thread that ever counted anything, kept until exit so that
+	// a report still sees the counts of threads that have finished
+	std::mutex lock;
+	std::vector<std::unique_ptr<uint64_t[]> > blocks;
+	std::atomic<uint64_t> peaks[maze::stats::counters];
+	std::atomic<int64_t> times[maze::stats::phases];
+}
+
+namespace maze {
+	namespace stats {
+		uint64_t *local() {
+			thread_local uint64_t *block = nullptr;
+			if(!block) {
+				std::lock_guard<std::mutex> held(lock);
+				blocks.emplace_back(new uint64_t[maze::stats::counters]());
+				block = blocks.back().get();
+			}
+			return block;
+		}
+		void peak(maze::stats::counter which, uint64_t value) {
+			uint64_t current = peaks[which].load(std::memory_order_relaxed);
+			while(value > current && !peaks[which].compare_exchange_weak(current, value, std::memory_order_relaxed));
+		}
+		void addTime(maze::stats::phase which, std::chrono::steady_clock::duration elapsed) {
+			times[which].fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count(), std::memory_order_relaxed);
+		}
+
+		phase_timer::phase_timer(maze::stats::phase which_):
+			which(which_), start(std::chrono::steady_clock::now()) {}
+		phase_timer::~phase_timer() {
+			maze::stats::addTime(which, std::chrono::steady_clock::now() - start);
+		}
+
+		bool enabled() {
+#ifdef MAZE_STATS
+			return true;
+#else
+			return false;
+#endif
+		}
+		// counters are read without stopping their threads, so call this
+		// once generation is over
+		std::string report() {
+			std::ostringstream out;
+			out << "{\"enabled\": " << (enabled() ? "true" : "false");
+			if(!enabled())
+				return out.str() + "}";
+
+			out << ", \"phases_s\": {";
+			for(int i = 0; i < maze::stats::phases; i++)
+				out << (i ? ", " : "") << "\"" << phase_names[i] << "\": " << times[i].load()*1e-9;
+			out << "}, \"counters\": {";
+			std::lock_guard<std::mutex> held(lock);
+			for(int i = 0; i < maze::stats::counters; i++) {
+				uint64_t total = peaks[i].load();
+				for(const auto &block: blocks)
+					total += block[i];
+				out << (i ? ", " : "") << "\"" << counter_names[i] << "\": " << total;
+			}
+			out << "}}";
+			return out.str();
+		}
+	}
+}
@@ -0,0 +1,57 @@
+#include <string>
+#include <chrono>
+#include <cstdint>
+
+#ifndef MAZE_STATS_INCLUDE_GUARD
+#define MAZE_STATS_INCLUDE_GUARD
+
+// hot-path instrumentation, compiled in with -DMAZE_STATS (make STATS=1);
+// otherwise every macro below expands to nothing and costs nothing
+#ifdef MAZE_STATS
+#define MAZE_COUNT(counter, n) (maze::stats::local()[maze::stats::counter] += (n))
+#define MAZE_PEAK(counter, value) maze::stats::peak(maze::stats::counter, (value))
+#define MAZE_PHASE_JOIN(a, b) a##b
+#define MAZE_PHASE_NAME(line) MAZE_PHASE_JOIN(maze_phase_, line)
+#define MAZE_PHASE(phase) maze::stats::phase_timer MAZE_PHASE_NAME(__LINE__)(maze::stats::phase)
+#else
+#define MAZE_COUNT(counter, n) ((void)0)
+#define MAZE_PEAK(counter, value) ((void)0)
+#define MAZE_PHASE(phase) ((void)0)
+#endif
+
+namespace maze {
+	namespace stats {
+		enum counter {
+			rng_blocks, rng_draws,
+			finds, find_steps, joins,
+			walk_steps, loop_erasures,
+			hunts, hunt_words,
+			frontier_peak, stack_peak,
+			counters
+		};
+		// phases nest: allocate is part of generate
+		enum phase {
+			allocate, generate, solve, analyze, render,
+			phases
+		};
+
+		// this thread's counters, summed over every thread by report()
+		uint64_t *local();
+		void peak(maze::stats::counter which, uint64_t value);
+		void addTime(maze::stats::phase which, std::chrono::steady_clock::duration elapsed);
+
+		class phase_timer {
+			maze::stats::phase which;
+			std::chrono::steady_clock::time_point start;
+		public:
+			phase_timer(maze::stats::phase which_);
+			~phase_timer();
+		};
+
+		bool enabled();
+		// every counter and phase time as one JSON object
+		std::string report();
+	}
+}
+
+#endif
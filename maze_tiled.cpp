@@ -0,0 +1,162 @@
+#include <algorithm>
+#include <mutex>
+#include <vector>
+#include <climits>
+#include <limits>
+#ifndef _WIN32
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "maze_tiled.hpp"
+#include "maze_binary.hpp"
+#include "maze_parallel.hpp"
+#include "maze_random.hpp"
+#include "maze_stats.hpp"
+
+namespace {
+#ifndef _WIN32
+	void writeAt(int fd, const char *data, std::size_t size, uint64_t offset) {
+		while(size) {
+			const ssize_t written = pwrite(fd, data, size, offset);
+			if(written < 0) {
+				if(errno == EINTR)
+					continue;
+				throw std::string("couldn't write output");
+			}
+			data += written;
+			size -= written;
+			offset += written;
+		}
+	}
+#endif
+}
+
+namespace maze {
+	// tile (tx, ty) starts at cell (tx*tile, ty*tile), and the tiles in the
+	// last column and row take what is left. Each tile writes its top and
+	// left walls but not its bottom and right ones, which belong to its
+	// neighbors, unless it is on the edge of the maze; so no byte of the
+	// output is written twice
+	void generateTiled(const std::string &path, uint64_t w, uint64_t h, int tile, const std::string &algo, uint64_t seed, const std::string &format, const std::string &wall, const std::string &blank) {
+#ifdef _WIN32
+		throw std::string("tiled generation isn't supported on this system");
+#else
+		const bool binary = format == "binary";
+		const uint64_t tw = (w + tile - 1)/tile, th = (h + tile - 1)/tile;
+		if(tw > INT_MAX)
+			throw "the maze is too wide for tiles of " + std::to_string(tile) + " cells; try " + std::to_string(w/INT_MAX + 1) + " or more";
+		if(binary && tile % 64)
+			throw std::string("binary tiles should be a multiple of 64 cells wide");
+		if(!binary && wall.size() != blank.size())
+			throw std::string("tiled text output needs walls and blank spaces of the same width");
+
+		// the text is 2h + 1 lines of 2w + 1 tiles and a newline; the binary
+		// file is laid out as in maze_binary.hpp. Every offset written to is
+		// below the size, so once the size fits in an off_t they all do
+		const uint64_t s = wall.size(), hstride = (w + 63)/64, vstride = (w + 64)/64;
+		uint64_t line = 0, planes = 0, size = 0;
+		const bool overflow = binary
+			? __builtin_mul_overflow(8*hstride, h + 1, &planes) || __builtin_add_overflow(planes, 64, &planes)
+				|| __builtin_mul_overflow(8*vstride, h, &size) || __builtin_add_overflow(size, planes, &size)
+			: __builtin_mul_overflow(2*w + 1, s, &line) || __builtin_add_overflow(line, 1, &line)
+				|| __builtin_mul_overflow(2*h + 1, line, &size);
+		if(overflow || size > uint64_t(std::numeric_limits<off_t>::max()))
+			throw std::string("the maze is too large for a file on this system");
+
+		const int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+		if(fd < 0)
+			throw "couldn't open " + path;
+		try {
+			if(ftruncate(fd, size) < 0)
+				throw "couldn't make room for " + path;
+			if(binary) {
+				std::string head;
+				maze::writeHeader(head, w, h, algo, seed);
+				writeAt(fd, head.data(), head.size(), 0);
+			}
+
+			// which neighboring tiles are joined comes from an Eller maze over
+			// the tiles, streamed a row of tiles at a time; the tiles reseed the
+			// thread's engine, so the stream keeps its own between rows
+			maze::eller_stream joins(tw);
+			maze::randinit(seed);
+			maze::philox order = maze::random_engine;
+			std::vector<uint64_t> above(joins.belowWords(), ~uint64_t(0)), below;
+
+			// pool threads can't throw, so a failure waits for the row to end
+			std::mutex lock;
+			std::string failure;
+			for(uint64_t ty = 0; ty < th && !failure.size(); ty++) {
+				{
+					MAZE_PHASE(generate);
+					maze::random_engine = order;
+					joins.advance(ty + 1 == th);
+					order = maze::random_engine;
+				}
+				const uint64_t *across = joins.sides();
+				below.assign(joins.below(), joins.below() + joins.belowWords());
+				auto closed = [](const uint64_t *row, int x) {
+					return row[x/64] >> x % 64 & 1;
+				};
+				maze::parallel_for(0, tw, [&](int from, int to) {
+					thread_local maze::workspace ws;
+					thread_local std::string text;
+					for(int tx = from; tx < to; tx++) {
+						try {
+							const uint64_t x0 = tx*uint64_t(tile), y0 = ty*tile, index = ty*tw + tx;
+							const int cw = std::min<uint64_t>(tile, w - x0), ch = std::min<uint64_t>(tile, h - y0);
+							const bool right = uint64_t(tx) + 1 == tw, bottom = ty + 1 == th;
+							{
+								MAZE_PHASE(generate);
+								maze::randinit(maze::hash(seed, 3*index));
+								maze::algo[algo](ws, cw, ch);
+							}
+
+							// one opening on each joined side, at a place the
+							// tiles on both sides of it agree on
+							maze::structure &maze = ws.result;
+							if(tx > 0 && !closed(across, tx))
+								maze.vertical().set(0, maze::hash(seed, 3*(index - 1) + 1) % ch, false);
+							if(!right && !closed(across, tx + 1))
+								maze.vertical().set(cw, maze::hash(seed, 3*index + 1) % ch, false);
+							if(ty > 0 && !closed(above.data(), tx))
+								maze.horizontal().set(maze::hash(seed, 3*(index - tw) + 2) % cw, 0, false);
+							if(!bottom && !closed(below.data(), tx))
+								maze.horizontal().set(maze::hash(seed, 3*index + 2) % cw, ch, false);
+
+							MAZE_PHASE(render);
+							if(binary) {
+								const std::size_t words = (cw + 63)/64, sides = right ? (cw + 64)/64 : words;
+								for(int i = 0; i < ch + bottom; i++)
+									writeAt(fd, reinterpret_cast<const char *>(maze.horizontal().row(i)), 8*words, 64 + 8*((y0 + i)*hstride + x0/64));
+								for(int i = 0; i < ch; i++)
+									writeAt(fd, reinterpret_cast<const char *>(maze.vertical().row(i)), 8*sides, planes + 8*((y0 + i)*vstride + x0/64));
+							} else {
+								text.clear();
+								maze.render(text, wall, blank);
+								const std::size_t tileLine = (2*cw + 1)*s + 1, span = 2*cw*s + (right ? s + 1 : 0);
+								for(int i = 0; i < 2*ch + bottom; i++)
+									writeAt(fd, text.data() + i*tileLine, span, (2*y0 + i)*line + 2*x0*s);
+							}
+						} catch(const std::string &msg) {
+							std::lock_guard<std::mutex> held(lock);
+							failure = msg;
+							return;
+						}
+					}
+				});
+				std::swap(above, below);
+			}
+			if(failure.size())
+				throw failure;
+		} catch(const std::string &) {
+			close(fd);
+			throw;
+		}
+		if(close(fd) < 0)
+			throw "couldn't write " + path;
+#endif
+	}
+}
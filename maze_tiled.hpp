@@ -0,0 +1,22 @@
+#include <string>
+#include <cstdint>
+
+#include "maze_algorithms.hpp"
+
+#ifndef MAZE_TILED_INCLUDE_GUARD
+#define MAZE_TILED_INCLUDE_GUARD
+
+namespace maze {
+	// generates a w x h maze, far beyond what fits in memory, as a grid of
+	// tiles of tile x tile cells. Each tile is a maze of its own from algo,
+	// seeded by the seed and its position, and the tiles are joined by an
+	// Eller maze over the tile grid with one opening per joined pair, so the
+	// whole maze is perfect too. That maze is streamed a row of tiles at a
+	// time, and the tiles of a row are generated in parallel and written
+	// straight into their place in the file at path, text or binary, so
+	// memory only depends on the tile size, the thread count and the number
+	// of tiles across
+	void generateTiled(const std::string &path, uint64_t w, uint64_t h, int tile, const std::string &algo, uint64_t seed, const std::string &format, const std::string &wall, const std::string &blank);
+}
+
+#endif